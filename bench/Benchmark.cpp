@@ -0,0 +1,620 @@
+/*
+ * @file: Benchmark.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+/*
+ * Blob sort benchmark
+ *
+ * Generates input blobs of 32-bit values, sorts each of them by SortBlob32 in a child process
+ * and prints a JSON object per run to stdout, one per line. Each child is a fresh process,
+ * so its CPU time and peak RSS reported by wait4() belong to that sort only.
+ *
+ * Build from the repository root, the blobsort_bench target links all the library sources:
+ *     cmake -S . -B build && cmake --build build --target blobsort_bench
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <cstdio>
+#include <cerrno>
+
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "BlobSort.h"
+
+namespace
+{
+
+constexpr size_t GENERATE_BLOCK_COUNT = 1 << 20; ///< Count of values generated and written at once
+constexpr size_t FEW_DISTINCT_COUNT = 16; ///< Count of distinct values of the "few" distribution
+constexpr size_t ZIPF_DISTINCT_COUNT = 1 << 20; ///< Count of distinct values of the "zipf" distribution
+constexpr double ZIPF_EXPONENT = 1.0;
+constexpr uint32_t RANK_SCATTER_FACTOR = 0x9E3779B1; ///< Odd, so multiplication maps ranks to values one-to-one
+
+enum LongOnlyOption
+{
+	OPTION_COMPRESS = 256, ///< Past any short option character
+	OPTION_PARALLEL_RUNS,
+	OPTION_VERIFY,
+};
+
+/**
+ * @brief Input value distribution
+ */
+enum class Distribution
+{
+	Uniform, ///< Uniform random values
+	Sorted, ///< Ascending values
+	Reverse, ///< Descending values
+	Few, ///< Random picks of a few distinct values
+	Zipf, ///< Zipf distributed values - a few values are very frequent, most are rare
+};
+
+const struct
+{
+	const char* name;
+	Distribution distribution;
+} DISTRIBUTIONS[] =
+{
+	{ "uniform", Distribution::Uniform },
+	{ "sorted", Distribution::Sorted },
+	{ "reverse", Distribution::Reverse },
+	{ "few", Distribution::Few },
+	{ "zipf", Distribution::Zipf },
+};
+
+const char* DistributionName(Distribution distribution)
+{
+	for (const auto& entry : DISTRIBUTIONS)
+	{
+		if (entry.distribution == distribution)
+		{
+			return entry.name;
+		}
+	}
+
+	return "unknown";
+}
+
+struct BenchmarkOptions
+{
+	uintmax_t size = 256ULL << 20; ///< Input size in bytes
+	std::vector<Distribution> distributions; ///< Empty - all of them
+	unsigned repeat = 3; ///< Count of sorts of each input
+	std::string directory = "."; ///< Directory of input and output files
+	uint64_t seed = 1;
+	bool verify = false; ///< Check output after each sort
+	ring::SortOptions sortOptions;
+};
+
+/**
+ * @brief Result reported by a child process sorting the input
+ */
+struct ChildResult
+{
+	double runGenerationSeconds;
+	double mergeSeconds;
+	ring::SortStats stats; ///< The last statistics report
+	bool ok;
+	char error[256];
+};
+
+void PrintUsage()
+{
+	std::cerr << "Usage: blobsort_bench [options]\n"
+		"Options:\n"
+		"  -s, --size=SIZE          input size (default 256M)\n"
+		"  -d, --distribution=LIST  comma separated list of uniform, sorted, reverse, few, zipf (default all)\n"
+		"  -r, --repeat=COUNT       count of sorts of each input (default 3)\n"
+		"  -D, --dir=PATH           directory of input and output files (default current)\n"
+		"  -S, --seed=NUMBER        random seed (default 1)\n"
+		"  -m, --memory=SIZE        memory budget (default 256M)\n"
+		"  -c, --chunk-size=SIZE    sorted run size\n"
+		"  -f, --fan-in=COUNT       max count of runs merged at once\n"
+		"  -k, --kernel=radix|std   in-memory sort algorithm\n"
+		"  -j, --threads=COUNT      count of worker threads\n"
+		"      --compress           compress temp run files\n"
+		"      --parallel-runs      sort each run using all the threads\n"
+		"      --verify             check output is a sorted permutation of input\n"
+		"SIZE is a count of bytes with an optional K, M or G suffix\n";
+}
+
+bool ParseSize(const char* arg, uintmax_t& size)
+{
+	char* end = nullptr;
+	size = strtoull(arg, &end, 10);
+
+	if (end == arg)
+	{
+		return false;
+	}
+
+	switch (*end)
+	{
+	case 'G': case 'g': size <<= 10; // fall through
+	case 'M': case 'm': size <<= 10; // fall through
+	case 'K': case 'k': size <<= 10; ++end; break;
+	default: break;
+	}
+
+	return *end == '\0';
+}
+
+bool ParseCount(const char* arg, unsigned& count)
+{
+	uintmax_t size = 0;
+
+	if (!ParseSize(arg, size) || size > std::numeric_limits<unsigned>::max())
+	{
+		return false;
+	}
+
+	count = size;
+	return true;
+}
+
+bool ParseDistributions(const char* arg, std::vector<Distribution>& distributions)
+{
+	std::istringstream list(arg);
+
+	for (std::string name; std::getline(list, name, ',');)
+	{
+		auto entry = std::find_if(std::begin(DISTRIBUTIONS), std::end(DISTRIBUTIONS),
+			[&](const auto& entry){	return name == entry.name;});
+
+		if (entry == std::end(DISTRIBUTIONS))
+		{
+			return false;
+		}
+
+		distributions.push_back(entry->distribution);
+	}
+
+	return !distributions.empty();
+}
+
+bool ParseOptions(int argc, char* argv[], BenchmarkOptions& options)
+{
+	const option longOptions[] =
+	{
+		{ "size", required_argument, nullptr, 's' },
+		{ "distribution", required_argument, nullptr, 'd' },
+		{ "repeat", required_argument, nullptr, 'r' },
+		{ "dir", required_argument, nullptr, 'D' },
+		{ "seed", required_argument, nullptr, 'S' },
+		{ "memory", required_argument, nullptr, 'm' },
+		{ "chunk-size", required_argument, nullptr, 'c' },
+		{ "fan-in", required_argument, nullptr, 'f' },
+		{ "kernel", required_argument, nullptr, 'k' },
+		{ "threads", required_argument, nullptr, 'j' },
+		{ "compress", no_argument, nullptr, OPTION_COMPRESS },
+		{ "parallel-runs", no_argument, nullptr, OPTION_PARALLEL_RUNS },
+		{ "verify", no_argument, nullptr, OPTION_VERIFY },
+		{ nullptr, 0, nullptr, 0 },
+	};
+
+	for (int opt; (opt = getopt_long(argc, argv, "s:d:r:D:S:m:c:f:k:j:", longOptions, nullptr)) != -1;)
+	{
+		bool ok = false;
+		uintmax_t seed = 0;
+
+		switch (opt)
+		{
+		case 's':
+			ok = ParseSize(optarg, options.size) && options.size % sizeof(uint32_t) == 0;
+			break;
+		case 'd':
+			ok = ParseDistributions(optarg, options.distributions);
+			break;
+		case 'r':
+			ok = ParseCount(optarg, options.repeat) && options.repeat;
+			break;
+		case 'D':
+			options.directory = optarg;
+			ok = true;
+			break;
+		case 'S':
+			ok = ParseSize(optarg, seed);
+			options.seed = seed;
+			break;
+		case 'm':
+			ok = ParseSize(optarg, options.sortOptions.memoryBudget) && options.sortOptions.memoryBudget;
+			break;
+		case 'c':
+			ok = ParseSize(optarg, options.sortOptions.chunkSize);
+			break;
+		case 'f':
+			ok = ParseCount(optarg, options.sortOptions.mergeFanIn);
+			break;
+		case 'k':
+			ok = true;
+			if (!strcmp(optarg, "radix"))
+			{
+				options.sortOptions.sortKernel = ring::SortKernel::Radix;
+			}
+			else if (!strcmp(optarg, "std"))
+			{
+				options.sortOptions.sortKernel = ring::SortKernel::Std;
+			}
+			else
+			{
+				ok = false;
+			}
+			break;
+		case 'j':
+			ok = ParseCount(optarg, options.sortOptions.threadCount);
+			break;
+		case OPTION_COMPRESS:
+			options.sortOptions.compressRuns = ok = true;
+			break;
+		case OPTION_PARALLEL_RUNS:
+			options.sortOptions.parallelRuns = ok = true;
+			break;
+		case OPTION_VERIFY:
+			options.verify = ok = true;
+			break;
+		default:
+			break;
+		}
+
+		if (!ok)
+		{
+			return false;
+		}
+	}
+
+	if (options.distributions.empty())
+	{
+		for (const auto& entry : DISTRIBUTIONS)
+		{
+			options.distributions.push_back(entry.distribution);
+		}
+	}
+
+	return optind == argc;
+}
+
+/**
+ * @brief Zipf distributed ranks
+ *
+ * Samples ranks 0 to count - 1 by the inverse of the cumulative distribution
+ */
+class ZipfDistribution
+{
+public:
+	ZipfDistribution(size_t count, double exponent)
+		: m_cdf(count)
+	{
+		double sum = 0;
+		for (size_t rank = 0; rank < count; rank++)
+		{
+			sum += 1 / std::pow(rank + 1, exponent);
+			m_cdf[rank] = sum;
+		}
+
+		for (auto& probability : m_cdf)
+		{
+			probability /= sum;
+		}
+	}
+
+	template <typename Generator>
+	size_t operator()(Generator& generator)
+	{
+		auto probability = std::uniform_real_distribution<double>()(generator);
+		auto rank = std::lower_bound(m_cdf.cbegin(), m_cdf.cend(), probability) - m_cdf.cbegin();
+
+		return std::min<size_t>(rank, m_cdf.size() - 1);
+	}
+
+private:
+	std::vector<double> m_cdf;
+};
+
+/**
+ * @brief Generate input file
+ *
+ * @param fileName - file to create
+ * @param distribution - value distribution
+ * @param size - file size in bytes
+ * @param seed - random seed
+ */
+void GenerateInput(const std::string& fileName, Distribution distribution, uintmax_t size, uint64_t seed)
+{
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		throw ring::SortException("Failed to create " + fileName);
+	}
+
+	std::mt19937_64 generator(seed);
+	std::uniform_int_distribution<uint32_t> uniform;
+
+	std::vector<uint32_t> few(FEW_DISTINCT_COUNT);
+	std::generate(few.begin(), few.end(), [&](){	return uniform(generator);});
+
+	std::unique_ptr<ZipfDistribution> zipf;
+	if (distribution == Distribution::Zipf)
+	{
+		zipf = std::make_unique<ZipfDistribution>(ZIPF_DISTINCT_COUNT, ZIPF_EXPONENT);
+	}
+
+	auto count = size / sizeof(uint32_t);
+	auto step = std::max<uintmax_t>(std::numeric_limits<uint32_t>::max() / std::max<uintmax_t>(count, 1), 1);
+
+	std::vector<uint32_t> block(GENERATE_BLOCK_COUNT);
+	for (uintmax_t index = 0; index < count;)
+	{
+		auto blockCount = std::min<uintmax_t>(block.size(), count - index);
+
+		for (size_t i = 0; i < blockCount; i++, index++)
+		{
+			switch (distribution)
+			{
+			case Distribution::Uniform:
+				block[i] = uniform(generator);
+				break;
+			case Distribution::Sorted:
+				block[i] = static_cast<uint32_t>(index * step);
+				break;
+			case Distribution::Reverse:
+				block[i] = static_cast<uint32_t>((count - 1 - index) * step);
+				break;
+			case Distribution::Few:
+				block[i] = few[uniform(generator) % few.size()];
+				break;
+			case Distribution::Zipf:
+				// Scatter ranks, so frequent values are not the smallest ones
+				block[i] = static_cast<uint32_t>((*zipf)(generator)) * RANK_SCATTER_FACTOR;
+				break;
+			}
+		}
+
+		file.write(reinterpret_cast<const char*>(block.data()), blockCount * sizeof(uint32_t));
+	}
+
+	if (!file.flush())
+	{
+		throw ring::SortException("Failed to write " + fileName);
+	}
+}
+
+/**
+ * @brief Check output is a sorted permutation of input
+ *
+ * Compares order independent checksums, as the input may not fit in memory
+ */
+bool Verify(const std::string& inFileName, const std::string& outFileName)
+{
+	auto checksum = [](const std::string& fileName, bool& sorted)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		std::vector<uint32_t> block(GENERATE_BLOCK_COUNT);
+		uint64_t sum = 0, squares = 0;
+		uint32_t previous = 0;
+		sorted = true;
+
+		while (file.read(reinterpret_cast<char*>(block.data()), block.size() * sizeof(uint32_t)) || file.gcount())
+		{
+			auto count = static_cast<size_t>(file.gcount()) / sizeof(uint32_t);
+			for (size_t i = 0; i < count; i++)
+			{
+				sorted = sorted && previous <= block[i];
+				previous = block[i];
+				sum += block[i];
+				squares += uint64_t(block[i]) * block[i];
+			}
+		}
+
+		return std::make_pair(sum, squares);
+	};
+
+	bool inSorted = false, outSorted = false;
+	return checksum(inFileName, inSorted) == checksum(outFileName, outSorted) && outSorted;
+}
+
+/**
+ * @brief Sort input in a child process
+ *
+ * @param[out] result - phase times reported by the child
+ * @param[out] usage - resource usage of the child
+ *
+ * @return Wall time of the child in seconds
+ */
+double RunChild(const std::string& inFileName, const std::string& outFileName, const ring::SortOptions& sortOptions,
+	ChildResult& result, rusage& usage)
+{
+	int fds[2];
+	if (pipe(fds))
+	{
+		throw ring::SortException(std::string("Failed to create pipe: ") + strerror(errno));
+	}
+
+	std::cout.flush();
+	auto start = std::chrono::steady_clock::now();
+
+	auto pid = fork();
+	if (pid < 0)
+	{
+		throw ring::SortException(std::string("Failed to fork: ") + strerror(errno));
+	}
+
+	if (!pid)
+	{
+		close(fds[0]);
+
+		ChildResult childResult = {};
+		auto options = sortOptions;
+		options.phaseCallback = [&](ring::SortPhase phase, double seconds)
+		{
+			(phase == ring::SortPhase::RunGeneration ? childResult.runGenerationSeconds :
+				childResult.mergeSeconds) += seconds;
+		};
+		options.statsCallback = [&](const ring::SortStats& stats) { childResult.stats = stats; };
+		options.statsInterval = 0;
+
+		try
+		{
+			ring::SortBlob32(inFileName, outFileName, options);
+			childResult.ok = true;
+		}
+		catch (const ring::SortException& e)
+		{
+			strncpy(childResult.error, e.what(), sizeof(childResult.error) - 1);
+		}
+
+		// The result is smaller than PIPE_BUF, so it is written at once
+		auto written = write(fds[1], &childResult, sizeof(childResult));
+		_exit(written == sizeof(childResult) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	close(fds[1]);
+
+	result = {};
+	auto received = read(fds[0], &result, sizeof(result));
+	close(fds[0]);
+
+	int status = 0;
+	wait4(pid, &status, 0, &usage);
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (received != sizeof(result) || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+	{
+		result.ok = false;
+		snprintf(result.error, sizeof(result.error), "Child process failed, status %d", status);
+	}
+
+	return seconds;
+}
+
+double Seconds(const timeval& time)
+{
+	return time.tv_sec + time.tv_usec / 1e6;
+}
+
+/**
+ * @brief Escape string for JSON output
+ */
+std::string Quote(const std::string& text)
+{
+	std::ostringstream quoted;
+	quoted << '"';
+
+	for (auto c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			quoted << '\\' << c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			quoted << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+		}
+		else
+		{
+			quoted << c;
+		}
+	}
+
+	quoted << '"';
+	return quoted.str();
+}
+
+void Run(const BenchmarkOptions& options)
+{
+	auto inFileName = options.directory + "/blobsort_bench.in";
+	auto outFileName = options.directory + "/blobsort_bench.out";
+
+	for (auto distribution : options.distributions)
+	{
+		GenerateInput(inFileName, distribution, options.size, options.seed);
+
+		for (unsigned repeat = 0; repeat < options.repeat; repeat++)
+		{
+			ChildResult result;
+			rusage usage = {};
+			auto wallSeconds = RunChild(inFileName, outFileName, options.sortOptions, result, usage);
+			auto cpuSeconds = Seconds(usage.ru_utime) + Seconds(usage.ru_stime);
+
+			std::ostringstream json;
+			json << std::fixed << std::setprecision(6)
+				<< "{\"distribution\": " << Quote(DistributionName(distribution))
+				<< ", \"size\": " << options.size
+				<< ", \"repeat\": " << repeat
+				<< ", \"memory_budget\": " << options.sortOptions.memoryBudget
+				<< ", \"threads\": " << options.sortOptions.threadCount
+				<< ", \"ok\": " << (result.ok ? "true" : "false");
+
+			if (result.ok)
+			{
+				json << ", \"wall_seconds\": " << wallSeconds
+					<< ", \"cpu_seconds\": " << cpuSeconds
+					<< ", \"run_generation_seconds\": " << result.runGenerationSeconds
+					<< ", \"merge_seconds\": " << result.mergeSeconds
+					<< ", \"sort_seconds\": " << result.stats.sortSeconds
+					<< ", \"pool_wait_seconds\": " << result.stats.poolWaitSeconds
+					<< ", \"bytes_read\": " << result.stats.bytesRead
+					<< ", \"bytes_written\": " << result.stats.bytesWritten
+					<< ", \"run_count\": " << result.stats.runCount
+					<< ", \"throughput_mb_per_second\": " << options.size / double(1 << 20) / wallSeconds
+					<< ", \"peak_rss_kb\": " << usage.ru_maxrss;
+
+				if (options.verify)
+				{
+					json << ", \"verified\": " << (Verify(inFileName, outFileName) ? "true" : "false");
+				}
+			}
+			else
+			{
+				json << ", \"error\": " << Quote(result.error);
+			}
+
+			json << "}";
+			std::cout << json.str() << std::endl;
+		}
+	}
+
+	std::remove(inFileName.c_str());
+	std::remove(outFileName.c_str());
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkOptions options;
+
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		Run(options);
+	}
+	catch (const ring::SortException& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
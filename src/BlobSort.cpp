@@ -6,13 +6,25 @@
  */
 
 #include "BlobSort.h"
+#include "ThreadPool.h"
+#include "File.h"
+#include "RunCodec.h"
+#include "Simd.h"
+#include "Numa.h"
+#include "Histogram.h"
+#include "SparseIndex.h"
+#include "IoScheduler.h"
+#include "Trace.h"
 
 #include <cstring>
 #include <vector>
+#include <memory>
 #include <queue>
+#include <map>
+#include <array>
 #include <algorithm>
-#include <iterator>
 #include <thread>
+#include <atomic>
 #include <future>
 #include <mutex>
 #include <condition_variable>
@@ -20,344 +32,5225 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <limits>
+#include <type_traits>
+#include <numeric>
+#include <chrono>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 
 namespace fs = std::experimental::filesystem;
 
 namespace ring
 {
 
-namespace
-{
+namespace
+{
+
+constexpr auto AUTO_MEMORY_BUDGET_DIVISOR = 2; ///< Auto memory budget is a half of available memory, the rest is left for page cache
+constexpr auto RADIX_BITS = 11; ///< Radix sort digit width - 3 passes over 32-bit keys, 6 over 64-bit ones
+constexpr auto RADIX_BUCKET_COUNT = 1u << RADIX_BITS;
+constexpr auto MIN_SORT_SLICE_SIZE = 1 << 16; ///< Min count of values sorted by one thread of a parallel sort
+constexpr auto IO_BLOCK_ALIGNMENT = DIRECT_IO_ALIGNMENT; ///< Chunks and merge I/O blocks are multiples of this when possible
+constexpr size_t RUN_ENCODE_BUFFER_SIZE = 256 << 10; ///< 256Kb - Compressed runs are written in pieces of this size
+constexpr size_t HUGE_PAGE_SIZE = 2 << 20; ///< 2Mb - x86-64 huge page size
+constexpr size_t COUNTING_SAMPLE_BLOCK_COUNT = 64; ///< Counting sort decision is taken on this many blocks spread over the input
+constexpr size_t COUNTING_SAMPLE_BLOCK_SIZE = 1024; ///< Count of values in each sample block
+constexpr size_t COUNTING_SAMPLE_TRIM = 1024; ///< This part of sampled values at each end is not covered by the counting table
+constexpr size_t COUNTING_MIN_REPEAT = 8; ///< Sampled values must repeat this many times on average to be counted by hash
+constexpr size_t MIN_COUNTING_WINDOW = 1 << 16; ///< Counting table of this many keys is worth it for any input size
+constexpr size_t SCAN_BLOCK_SIZE = 1 << 20; ///< 1Mb - Input scanned as a whole is read and output is written in blocks of this size
+constexpr auto MANIFEST_FILE_NAME = "manifest"; ///< Manifest of a resumable sort in its first temp directory
+constexpr auto MANIFEST_SIGNATURE = "blobsort manifest 1";
+constexpr size_t MAX_NATURAL_RUN_COUNT = 16; ///< Adaptive sort merges up to this many natural runs instead of sorting
+constexpr size_t PARTITION_SAMPLE_BLOCK_COUNT = 256; ///< Partition splitters are picked from this many blocks spread over the input
+constexpr size_t PARTITION_SAMPLE_BLOCK_SIZE = 256; ///< Count of elements in each sample block
+constexpr size_t SCHEDULED_IO_SIZE = 8 << 20; ///< 8Mb - Blocks read or written under I/O limits are split into requests of this size
+constexpr auto SOURCE_NAME = "source"; ///< Input name of sorts of a source, see @ref SourceFile
+constexpr auto SINK_NAME = "sink"; ///< Output name of sorts to a sink, see @ref SinkFile
+
+/**
+ * Round up function (as suggested by Tigran Avanesov)
+ */
+template <typename T>
+T RoundUp(T num, T factor)
+{
+    return num + factor - 1 - (num - 1) % factor;
+}
+
+/**
+ * @brief Value type traits
+ *
+ * Maps values to unsigned keys of the same width ordered the same way, so radix sort
+ * only ever deals with unsigned keys. Unsigned values are keys themselves.
+ */
+template <typename T, typename Enable = void>
+struct KeyTraits
+{
+	static_assert(std::is_unsigned<T>::value, "Unsupported value type");
+
+	using Key = T;
+
+	static Key ToKey(T value)
+	{
+		return value;
+	}
+
+	static T FromKey(Key key)
+	{
+		return key;
+	}
+
+	static bool Less(T left, T right)
+	{
+		return left < right;
+	}
+};
+
+/**
+ * @brief Signed integer traits
+ *
+ * Flipping the sign bit moves negative values below positive ones
+ */
+template <typename T>
+struct KeyTraits<T, std::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value>>
+{
+	using Key = std::make_unsigned_t<T>;
+
+	static Key ToKey(T value)
+	{
+		return static_cast<Key>(value) ^ (Key(1) << (sizeof(Key) * 8 - 1));
+	}
+
+	static T FromKey(Key key)
+	{
+		return static_cast<T>(static_cast<Key>(key ^ (Key(1) << (sizeof(Key) * 8 - 1))));
+	}
+
+	static bool Less(T left, T right)
+	{
+		return left < right;
+	}
+};
+
+/**
+ * @brief IEEE floating point traits
+ *
+ * Negative values get all the bits flipped, so the larger magnitude the smaller key,
+ * positive ones get the sign bit set. Values are compared by keys too - it is a total order
+ * where -0 < +0 and NaNs go to the ends depending on their sign, instead of breaking the sort.
+ */
+template <typename T>
+struct KeyTraits<T, std::enable_if_t<std::is_floating_point<T>::value>>
+{
+	static_assert(std::numeric_limits<T>::is_iec559 && (sizeof(T) == 4 || sizeof(T) == 8), "Unsupported floating point type");
+
+	using Key = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+
+	static constexpr Key SIGN_BIT = Key(1) << (sizeof(Key) * 8 - 1);
+
+	static Key ToKey(T value)
+	{
+		Key key;
+		memcpy(&key, &value, sizeof(key));
+
+		return (key & SIGN_BIT) ? ~key : key | SIGN_BIT;
+	}
+
+	static T FromKey(Key key)
+	{
+		key = (key & SIGN_BIT) ? key ^ SIGN_BIT : ~key;
+
+		T value;
+		memcpy(&value, &key, sizeof(value));
+
+		return value;
+	}
+
+	static bool Less(T left, T right)
+	{
+		return ToKey(left) < ToKey(right);
+	}
+};
+
+/**
+ * @brief Record key paired with the record index in a run
+ */
+template <typename K>
+struct KeyIndex
+{
+	K key;
+	uint32_t index;
+};
+
+/**
+ * @brief Key-index pair traits
+ *
+ * Pairs are radix sorted by keys only, ties are ordered by index for comparison sorts
+ * to keep equal records in input order as radix sort does
+ */
+template <typename K>
+struct KeyTraits<KeyIndex<K>>
+{
+	using Key = typename KeyTraits<K>::Key;
+
+	static Key ToKey(const KeyIndex<K>& value)
+	{
+		return KeyTraits<K>::ToKey(value.key);
+	}
+
+	static bool Less(const KeyIndex<K>& left, const KeyIndex<K>& right)
+	{
+		return KeyTraits<K>::Less(left.key, right.key) ||
+			(!KeyTraits<K>::Less(right.key, left.key) && left.index < right.index);
+	}
+};
+
+template <typename T>
+constexpr int RadixDigitCount()
+{
+	return (sizeof(typename KeyTraits<T>::Key) * 8 + RADIX_BITS - 1) / RADIX_BITS;
+}
+
+using RadixHistogram = std::array<size_t, RADIX_BUCKET_COUNT>;
+
+template <typename T>
+inline size_t RadixDigit(const T& value, int digit)
+{
+	return (KeyTraits<T>::ToKey(value) >> (digit * RADIX_BITS)) & (RADIX_BUCKET_COUNT - 1);
+}
+
+/**
+ * @brief Pick destination buffer of the first radix sort pass
+ *
+ * Passes alternate destination buffers, so pick the first one for the last pass to write to data
+ * unless the input is data itself, or is scratch and there is an even count of passes
+ *
+ * @param input - values to sort. Either data, scratch or a separate buffer
+ * @param data, scratch - buffers to ping-pong between
+ * @param passCount - count of passes to be made
+ *
+ * @return Either data or scratch
+ */
+template <typename T>
+T* FirstRadixDestination(const T* input, T* data, T* scratch, size_t passCount)
+{
+	if (input == data)
+	{
+		return scratch;
+	}
+
+	return (input == scratch || passCount % 2) ? data : scratch;
+}
+
+/**
+ * @brief LSD radix sort
+ *
+ * Sorts values digit by digit of their keys ping-ponging between data and scratch buffers.
+ * Histograms for all the digits are collected in a single pass,
+ * passes where all the values share the same digit are skipped.
+ * Input may be separate from data (e.g. a mapped file), then the first pass reads it directly
+ * and the passes are arranged so sorted values end up in data. Input may also be scratch,
+ * then the first pass writes to data.
+ *
+ * @param input - values to sort. Either data, scratch or a separate buffer of the same size
+ * @param data - buffer to sort values in
+ * @param scratch - buffer of the same size as data
+ * @param size - count of values
+ *
+ * @return Pointer to sorted values - either data or scratch
+ */
+template <typename T>
+T* RadixSort(const T* input, T* data, T* scratch, size_t size)
+{
+	if (!size)
+	{
+		return data;
+	}
+
+	std::vector<RadixHistogram> counts(RadixDigitCount<T>());
+
+	for (auto value = input; value != input + size; ++value)
+	{
+		for (auto digit = 0; digit < RadixDigitCount<T>(); digit++)
+		{
+			counts[digit][RadixDigit(*value, digit)]++;
+		}
+	}
+
+	std::vector<int> digits;
+	for (auto digit = 0; digit < RadixDigitCount<T>(); digit++)
+	{
+		if (counts[digit][RadixDigit(input[0], digit)] != size)
+		{
+			digits.push_back(digit);
+		}
+	}
+
+	if (digits.empty())
+	{
+		return (input == data) ? data : std::copy(input, input + size, data) - size;
+	}
+
+	auto dest = FirstRadixDestination(input, data, scratch, digits.size());
+	auto other = (dest == data) ? scratch : data;
+	auto sorted = dest;
+
+	for (auto digit : digits)
+	{
+		auto& offsets = counts[digit];
+
+		size_t offset = 0;
+		for (auto& count : offsets)
+		{
+			offset += count;
+			count = offset - count;
+		}
+
+		for (auto value = input; value != input + size; ++value)
+		{
+			dest[offsets[RadixDigit(*value, digit)]++] = *value;
+		}
+
+		input = sorted = dest;
+		std::swap(dest, other);
+	}
+
+	return sorted;
+}
+
+/**
+ * @brief Find merge path split
+ *
+ * Finds how many of the first values of the merged sequence come from the left one
+ *
+ * @param left, leftSize - left sorted sequence
+ * @param right, rightSize - right sorted sequence
+ * @param diagonal - count of the first values of the merged sequence
+ *
+ * @return Count of values taken from the left sequence
+ */
+template <typename T>
+size_t MergePathSplit(const T* left, size_t leftSize, const T* right, size_t rightSize, size_t diagonal)
+{
+	auto lo = diagonal > rightSize ? diagonal - rightSize : 0;
+	auto hi = std::min(diagonal, leftSize);
+
+	while (lo < hi)
+	{
+		auto mid = lo + (hi - lo) / 2;
+
+		if (!KeyTraits<T>::Less(right[diagonal - mid - 1], left[mid]))
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/**
+ * @brief Merge two sorted arrays
+ */
+template <typename T>
+void MergeValues(const T* left, size_t leftSize, const T* right, size_t rightSize, T* out)
+{
+	std::merge(left, left + leftSize, right, right + rightSize, out, KeyTraits<T>::Less);
+}
+
+inline void MergeValues(const uint32_t* left, size_t leftSize, const uint32_t* right, size_t rightSize,
+	uint32_t* out)
+{
+	Simd::Merge(left, leftSize, right, rightSize, out);
+}
+
+/**
+ * @brief Count of the leading values of a sorted array not greater than bound
+ */
+template <typename T>
+size_t CountNotGreater(const T* values, size_t size, T bound)
+{
+	size_t count = 0;
+	while (count < size && !KeyTraits<T>::Less(bound, values[count]))
+	{
+		count++;
+	}
+
+	return count;
+}
+
+inline size_t CountNotGreater(const uint32_t* values, size_t size, uint32_t bound)
+{
+	return Simd::CountNotGreater(values, size, bound);
+}
+
+/**
+ * @brief Short name of value type, e.g. "u32" or "f64"
+ */
+template <typename T>
+std::string TypeName()
+{
+	return (std::is_floating_point<T>::value ? "f" : std::is_signed<T>::value ? "i" : "u") +
+		std::to_string(sizeof(T) * 8);
+}
+
+/**
+ * @brief Find natural runs - maximal ranges of non-decreasing values
+ *
+ * @param values - values to scan
+ * @param count - count of values
+ * @param maxCount - max count of runs to look for
+ *
+ * @return Offsets of the runs followed by count of values, empty if there are more than maxCount runs
+ */
+template <typename T>
+std::vector<size_t> FindNaturalRuns(const T* values, size_t count, size_t maxCount)
+{
+	std::vector<size_t> runs { 0 };
+
+	for (size_t i = 1; i < count; i++)
+	{
+		if (KeyTraits<T>::Less(values[i], values[i - 1]))
+		{
+			if (runs.size() == maxCount)
+			{
+				return {};
+			}
+
+			runs.push_back(i);
+		}
+	}
+
+	runs.push_back(count);
+	return runs;
+}
+
+/**
+ * @brief Check if values are in non-increasing order
+ */
+template <typename T>
+bool IsDescending(const T* values, size_t count)
+{
+	return std::is_sorted(values, values + count, [](T left, T right) { return KeyTraits<T>::Less(right, left); });
+}
+
+/**
+ * @brief Merge sorted slices pairwise on the calling thread
+ *
+ * @param data, scratch - buffers to ping-pong between, data holds sorted slices
+ * @param slices - offsets of the slices in values, followed by total count of values
+ *
+ * @return Pointer to sorted values - either data or scratch
+ */
+template <typename T>
+T* MergeSlices(T* data, T* scratch, std::vector<size_t> slices)
+{
+	for (; slices.size() > 2; std::swap(data, scratch))
+	{
+		std::vector<size_t> merged;
+
+		for (size_t i = 0; i + 1 < slices.size(); i += 2)
+		{
+			auto begin = slices[i];
+			auto mid = slices[i + 1];
+			auto end = (i + 2 < slices.size()) ? slices[i + 2] : mid;
+
+			MergeValues(data + begin, mid - begin, data + mid, end - mid, scratch + begin);
+			merged.push_back(begin);
+		}
+
+		merged.push_back(slices.back());
+		slices = std::move(merged);
+	}
+
+	return data;
+}
+
+/**
+ * @brief Parse value of a range bound
+ *
+ * @throw @ref ring::SortException if the text is not a value of T
+ */
+template <typename T>
+T ParseValue(const std::string& text)
+{
+	std::istringstream strm(text);
+	T value {};
+
+	// Streams negate unsigned values instead of failing
+	if ((std::is_unsigned<T>::value && text.find('-') != std::string::npos) || !(strm >> value) ||
+		!(strm >> std::ws).eof())
+	{
+		throw SortException("Invalid " + TypeName<T>() + " value: " + text);
+	}
+
+	return value;
+}
+
+/**
+ * @brief Selection of values for the output - a range of them, a limit of the smallest values count
+ * and collapse of equal ones
+ *
+ * Values are selected by keys. The cutoff - the greatest key selected, only gets lower as runs
+ * of the limit of values are sorted, so the runs sorted later drop more values upfront.
+ */
+template <typename T>
+class ValueSelection
+{
+public:
+	explicit ValueSelection(const SortOptions& options)
+		: m_low(options.rangeLow.empty() ? 0 : Traits::ToKey(ParseValue<T>(options.rangeLow)))
+			, m_limit(options.limit)
+			, m_active(options.limit || !options.rangeLow.empty() || !options.rangeHigh.empty())
+			, m_duplicates(options.duplicates)
+	{
+		auto high = options.rangeHigh.empty() ? std::numeric_limits<Key>::max() :
+			Traits::ToKey(ParseValue<T>(options.rangeHigh));
+
+		// The upper bound is exclusive unless there is none. An empty range selects nothing
+		if (!options.rangeHigh.empty() && high <= m_low)
+		{
+			m_low = std::numeric_limits<Key>::max();
+			m_cutoff = 0;
+		}
+		else
+		{
+			m_cutoff = options.rangeHigh.empty() ? high : high - 1;
+		}
+
+		if (m_active || m_duplicates != DuplicateMode::Keep)
+		{
+			std::stringstream strm;
+			strm << "selection " << uintmax_t(m_low) << ' ' << uintmax_t(m_cutoff.load()) << ' ' << m_limit << ' '
+				<< static_cast<int>(m_duplicates);
+			m_description = strm.str();
+		}
+	}
+
+	/**
+	 * @brief Check if any selection is made, all the values are selected otherwise
+	 */
+	bool Active() const
+	{
+		return m_active;
+	}
+
+	/**
+	 * @brief Max count of values selected, 0 - no limit
+	 */
+	uintmax_t Limit() const
+	{
+		return m_limit;
+	}
+
+	bool Selected(T value) const
+	{
+		auto key = Traits::ToKey(value);
+		return key >= m_low && key <= m_cutoff.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Select elements, keeping at most the limit of the smallest ones
+	 *
+	 * The smallest elements are found by quickselect. It reorders them unless a scratch buffer is given,
+	 * then the order of elements is kept at the cost of a copy
+	 *
+	 * @param input - elements to select from
+	 * @param output - buffer to store selected elements in, may be the input
+	 * @param count - count of elements
+	 * @param valueOf - function returning value of an element
+	 * @param scratch - buffer of count elements or nullptr
+	 *
+	 * @return Count of selected elements
+	 */
+	template <typename E, typename F>
+	size_t Select(const E* input, E* output, size_t count, F valueOf, E* scratch = nullptr) const
+	{
+		size_t selected = 0;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (Selected(valueOf(input[i])))
+			{
+				output[selected++] = input[i];
+			}
+		}
+
+		// The limit of distinct values is only known to be reached once they are sorted, see @ref SelectSorted
+		if (!m_limit || m_duplicates != DuplicateMode::Keep || selected <= m_limit)
+		{
+			return selected;
+		}
+
+		if (!scratch)
+		{
+			std::nth_element(output, output + m_limit, output + selected, KeyTraits<E>::Less);
+			return m_limit;
+		}
+
+		// Elements are ordered totally, so exactly the limit of them are not greater than the last one kept
+		std::copy(output, output + selected, scratch);
+		std::nth_element(scratch, scratch + m_limit - 1, scratch + selected, KeyTraits<E>::Less);
+
+		auto last = scratch[m_limit - 1];
+		std::remove_if(output, output + selected, [&](const E& element) { return KeyTraits<E>::Less(last, element); });
+
+		return m_limit;
+	}
+
+	/**
+	 * @brief Collapse equal sorted elements and keep at most the limit of the smallest ones
+	 *
+	 * Equal elements are collapsed into the first one for unique output, and left to be counted as they are
+	 * written for counted output. The cutoff is lowered as by @ref Update
+	 *
+	 * @param sorted - sorted selected elements
+	 * @param count - count of elements
+	 * @param valueOf - function returning value of an element
+	 *
+	 * @return Count of elements kept
+	 */
+	template <typename E, typename F>
+	size_t SelectSorted(E* sorted, size_t count, F valueOf)
+	{
+		auto equal = [&](const E& left, const E& right)
+		{	return Traits::ToKey(valueOf(left)) == Traits::ToKey(valueOf(right));};
+
+		if (m_duplicates == DuplicateMode::Unique)
+		{
+			count = std::unique(sorted, sorted + count, equal) - sorted;
+		}
+
+		size_t kept = count;
+		uintmax_t distinct = count;
+
+		if (m_limit && m_duplicates == DuplicateMode::Count)
+		{
+			distinct = 0;
+
+			for (kept = 0; kept < count; kept++)
+			{
+				if (!kept || !equal(sorted[kept - 1], sorted[kept]))
+				{
+					if (distinct == m_limit)
+					{
+						break;
+					}
+
+					distinct++;
+				}
+			}
+		}
+		else if (m_limit && count > m_limit)
+		{
+			kept = distinct = m_limit;
+		}
+
+		if (kept)
+		{
+			Update(valueOf(sorted[kept - 1]), distinct);
+		}
+
+		return kept;
+	}
+
+	/**
+	 * @brief Lower the cutoff down to the greatest of sorted selected values if there are as many as the limit
+	 */
+	void Update(T greatest, size_t count)
+	{
+		if (!m_limit || count < m_limit)
+		{
+			return;
+		}
+
+		auto key = Traits::ToKey(greatest);
+		auto cutoff = m_cutoff.load();
+
+		while (key < cutoff && !m_cutoff.compare_exchange_weak(cutoff, key))
+		{
+		}
+	}
+
+	/**
+	 * @brief Description of the selection as made by options, for manifest of a resumable sort
+	 *
+	 * @return Empty string if all the values are output as they are
+	 */
+	const std::string& Description() const
+	{
+		return m_description;
+	}
+
+private:
+	using Traits = KeyTraits<T>;
+	using Key = typename Traits::Key;
+
+	Key m_low;
+	std::atomic<Key> m_cutoff;
+	const uintmax_t m_limit;
+	const bool m_active;
+	const DuplicateMode m_duplicates;
+	std::string m_description;
+};
+
+/**
+ * @brief A RAII helper class to add time spent in scope to a counter of nanoseconds
+ *
+ * The scope is also recorded as a span if there is a tracer, see @ref SortOptions::traceFile
+ */
+class ScopedTimer
+{
+public:
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+	explicit ScopedTimer(std::atomic<int64_t>& counter, Tracer* tracer = nullptr, const char* span = nullptr,
+		const Tracer::Args& args = {})
+		: m_counter(counter)
+			, m_tracer(tracer)
+			, m_span(span)
+			, m_args(args)
+			, m_start(std::chrono::steady_clock::now())
+	{
+	}
+
+	~ScopedTimer() noexcept
+	{
+		auto end = std::chrono::steady_clock::now();
+		m_counter += std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count();
+
+		if (m_tracer)
+		{
+			try
+			{
+				m_tracer->Add(m_span, m_start, end, m_args);
+			}
+			catch (...)
+			{
+				// Out of memory for the trace, the sort goes on without a span
+			}
+		}
+	}
+
+	/**
+	 * @brief Add an arg of the span known once the scope is under way, such as count of bytes read
+	 */
+	void AddArg(const char* name, uint64_t value)
+	{
+		m_args.Add(name, value);
+	}
+
+private:
+	std::atomic<int64_t>& m_counter;
+	Tracer* const m_tracer;
+	const char* const m_span;
+	Tracer::Args m_args;
+	const std::chrono::steady_clock::time_point m_start;
+};
+
+inline double Seconds(const std::atomic<int64_t>& nanoseconds)
+{
+	return nanoseconds / 1e9;
+}
+
+/**
+ * @brief Sort counters updated by all the threads
+ *
+ * Times are in nanoseconds, see @ref SortStats for the meaning of each counter
+ */
+struct SortCounters
+{
+	std::atomic<uintmax_t> sortedBytes { 0 }; ///< Input bytes written to sorted runs or output by run generation
+	std::atomic<uintmax_t> bytesRead { 0 };
+	std::atomic<uintmax_t> bytesWritten { 0 };
+	std::atomic<uintmax_t> runCount { 0 };
+	std::atomic<uintmax_t> mergeCount { 0 };
+	std::atomic<int64_t> readTime { 0 };
+	std::atomic<int64_t> sortTime { 0 };
+	std::atomic<int64_t> writeTime { 0 };
+	std::atomic<int64_t> mergeTime { 0 };
+	std::atomic<size_t> readQueueDepth { 0 };
+	std::atomic<size_t> writeQueueDepth { 0 };
+	IoScheduler* ioScheduler = nullptr; ///< Scheduler of the counted reads and writes, none - no limits
+	Tracer* tracer = nullptr; ///< Tracer of the timed spans, none - no trace
+};
+
+/**
+ * @brief Read block of file as granted by the I/O scheduler of counters
+ *
+ * Parameters and result are the same as of @ref File::Read
+ */
+size_t ReadScheduled(File& file, char* buffer, size_t size, uint64_t offset, SortCounters& counters)
+{
+	if (!counters.ioScheduler || !counters.ioScheduler->Active())
+	{
+		return file.Read(buffer, size, offset);
+	}
+
+	auto device = file.Device();
+	size_t done = 0;
+
+	while (done < size)
+	{
+		auto part = std::min(size - done, SCHEDULED_IO_SIZE);
+		IoScheduler::Grant grant(counters.ioScheduler, device, part);
+		auto res = file.Read(buffer + done, part, offset + done);
+
+		done += res;
+
+		if (res < part)
+		{
+			break;
+		}
+	}
+
+	return done;
+}
+
+/**
+ * @brief Write block of file as granted by the I/O scheduler of counters
+ *
+ * Parameters are the same as of @ref File::Write
+ */
+void WriteScheduled(File& file, const char* buffer, size_t size, uint64_t offset, SortCounters& counters)
+{
+	if (!counters.ioScheduler || !counters.ioScheduler->Active())
+	{
+		file.Write(buffer, size, offset);
+		return;
+	}
+
+	auto device = file.Device();
+
+	for (size_t done = 0; done < size;)
+	{
+		auto part = std::min(size - done, SCHEDULED_IO_SIZE);
+		IoScheduler::Grant grant(counters.ioScheduler, device, part);
+
+		file.Write(buffer + done, part, offset + done);
+		done += part;
+	}
+}
+
+/**
+ * @brief Pool of files opened for reading the same path
+ *
+ * Files are opened on demand and reused by the threads reading chunks, instead of opening
+ * the file for each chunk. A file is held by one thread at a time, since io_uring backed files
+ * aren't thread-safe, so there are as many of them as threads reading at once.
+ */
+class ReadFilePool
+{
+public:
+	/**
+	 * @brief Opened file
+	 *
+	 * A RAII helper class to automatically return acquired file to the pool
+	 */
+	class Lease
+	{
+		friend class ReadFilePool;
+
+	public:
+		Lease(const Lease&) = delete;
+		Lease& operator=(const Lease&) = delete;
+
+		Lease(Lease&& other) = default;
+
+		File& operator*()
+		{
+			return *m_file;
+		}
+
+		~Lease() noexcept
+		{
+			if (m_file)
+			{
+				m_pool.Release(std::move(m_file));
+			}
+		}
+
+	private:
+		Lease(ReadFilePool& pool, std::unique_ptr<File> file)
+			: m_pool(pool)
+				, m_file(std::move(file))
+		{
+		}
+
+		ReadFilePool& m_pool;
+		std::unique_ptr<File> m_file;
+	};
+
+	ReadFilePool(const ReadFilePool&) = delete;
+	ReadFilePool& operator=(const ReadFilePool&) = delete;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param path, backend - see @ref File::Open, nothing is opened until acquired
+	 */
+	ReadFilePool(const fs::path& path, IoBackend backend)
+		: m_path(path)
+			, m_backend(backend)
+	{
+	}
+
+	/**
+	 * @brief Acquire file not used by other threads, opening one if there is none
+	 *
+	 * @throw @ref ring::SortException if the file can't be opened
+	 */
+	Lease Acquire()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (!m_files.empty())
+			{
+				auto file = std::move(m_files.back());
+				m_files.pop_back();
+				return Lease(*this, std::move(file));
+			}
+		}
+
+		return Lease(*this, File::Open(m_path.string(), File::Mode::Read, m_backend));
+	}
+
+private:
+	void Release(std::unique_ptr<File> file) noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		try
+		{
+			m_files.push_back(std::move(file));
+		}
+		catch (...)
+		{
+			// Out of memory, the file is closed instead of being reused
+		}
+	}
+
+	const fs::path m_path;
+	const IoBackend m_backend;
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<File>> m_files; ///< Files not used by any thread
+};
+
+/**
+ * @brief Anonymous memory mapping
+ *
+ * Pages are committed on first touch, so each lands on the NUMA node of the thread touching it first.
+ * Huge pages are taken from the reserved hugetlb pages if there are enough of them,
+ * transparent huge pages are requested otherwise.
+ */
+class PageBuffer
+{
+public:
+	PageBuffer(const PageBuffer&) = delete;
+	PageBuffer& operator=(const PageBuffer&) = delete;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param size - size in bytes
+	 * @param hugePages - back the buffer with huge pages
+	 *
+	 * @throw std::bad_alloc
+	 */
+	PageBuffer(size_t size, bool hugePages)
+		: m_size(RoundUp<size_t>(std::max<size_t>(size, 1), hugePages ? HUGE_PAGE_SIZE : DIRECT_IO_ALIGNMENT))
+	{
+		if (hugePages)
+		{
+			m_data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		}
+
+		if (m_data == MAP_FAILED)
+		{
+			m_data = hugePages ? MapAligned(m_size, HUGE_PAGE_SIZE) :
+				mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+			if (m_data == MAP_FAILED)
+			{
+				throw std::bad_alloc();
+			}
+
+			if (hugePages)
+			{
+				madvise(m_data, m_size, MADV_HUGEPAGE);
+			}
+		}
+	}
+
+	~PageBuffer() noexcept
+	{
+		munmap(m_data, m_size);
+	}
+
+	char* Data() const
+	{
+		return static_cast<char*>(m_data);
+	}
+
+private:
+	/**
+	 * @brief Map memory aligned to alignment, so all of it can be backed by transparent huge pages
+	 */
+	static void* MapAligned(size_t size, size_t alignment)
+	{
+		auto data = mmap(nullptr, size + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (data == MAP_FAILED)
+		{
+			return data;
+		}
+
+		auto start = reinterpret_cast<uintptr_t>(data);
+		auto head = RoundUp<uintptr_t>(start, alignment) - start;
+
+		if (head)
+		{
+			munmap(data, head);
+		}
+
+		munmap(static_cast<char*>(data) + head + size, alignment - head);
+
+		return static_cast<char*>(data) + head;
+	}
+
+	const size_t m_size;
+	void* m_data = MAP_FAILED;
+};
+
+/**
+ * @brief Simple blocking memory pool
+ *
+ * Free chunks are kept in a lock-free stack, and a counter of them is decremented
+ * before a chunk is popped, so a caller reserves all the chunks it needs at once or none.
+ * Callers only block when the pool is exhausted, and a release only takes the lock
+ * if there are blocked callers.
+ *
+ * Chunks may be split between NUMA nodes, each node having a stack of its own chunks.
+ * A chunk is taken from the node of the calling thread if there is a free one there.
+ */
+class SimpleBlockingMemoryPool
+{
+	friend class Chunk;
+
+public:
+	/**
+	 * @brief Memory chunk
+	 *
+	 * A RAII helper class to automatically release acquired chunk
+	 */
+	class Chunk
+	{
+		friend class SimpleBlockingMemoryPool;
+
+	public:
+		Chunk(const Chunk&) = delete;
+		Chunk& operator=(const Chunk&) = delete;
+
+		Chunk(Chunk&& other)
+			:
+				m_pool(other.m_pool)
+		{
+			std::swap(m_buff, other.m_buff);
+		}
+
+		operator char*()
+		{
+			return m_buff;
+		}
+
+		char* Data()
+		{
+			return m_buff;
+		}
+
+		~Chunk() noexcept
+		{
+			if (m_buff)
+			{
+				m_pool.Release(m_buff);
+			}
+		}
+
+	private:
+		explicit Chunk(SimpleBlockingMemoryPool& pool)
+			: m_pool(pool)
+		{
+		}
+
+		SimpleBlockingMemoryPool& m_pool;
+		char* m_buff = nullptr;
+	};
+
+	SimpleBlockingMemoryPool(const SimpleBlockingMemoryPool&) = delete;
+	SimpleBlockingMemoryPool operator=(const SimpleBlockingMemoryPool&) = delete;
+
+	/**
+	 * @biref Constructor
+	 *
+	 * Construct pool given object size and count
+	 *
+	 * @param size - size of object in bytes
+	 * @param count - count of objects in pool.
+	 * @param hugePages - back objects with huge pages
+	 * @param nodes - ids of NUMA nodes to split objects between. Empty - no NUMA placement
+	 * @param tracer - tracer of waits for objects, if any
+	 */
+	SimpleBlockingMemoryPool(size_t size, size_t count, bool hugePages, const std::vector<unsigned>& nodes,
+		Tracer* tracer = nullptr)
+		: m_size(size)
+			, m_count(count)
+			, m_buff(size * count, hugePages)
+			, m_next(std::make_unique<std::atomic<uint32_t>[]>(count))
+			, m_owners(count)
+			, m_nodes(nodes.empty() ? std::vector<unsigned> { 0 } : nodes)
+			, m_heads(std::make_unique<std::atomic<uint64_t>[]>(m_nodes.size()))
+			, m_tracer(tracer)
+	{
+		if (count > std::numeric_limits<uint32_t>::max())
+		{
+			throw SortException("Pool depth is too large");
+		}
+
+		auto pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+
+		for (size_t node = 0; node < m_nodes.size(); node++)
+		{
+			auto begin = node * count / m_nodes.size();
+			auto end = (node + 1) * count / m_nodes.size();
+
+			for (auto i = begin; i < end; i++)
+			{
+				m_owners[i] = node;
+				Push(i);
+			}
+
+			// Pages shared by chunks of two nodes go to the second one
+			auto first = RoundUp(reinterpret_cast<uintptr_t>(m_buff.Data() + begin * size), pageSize);
+			auto last = reinterpret_cast<uintptr_t>(m_buff.Data() + end * size);
+
+			if (!nodes.empty() && first < last)
+			{
+				Numa::PreferNode(reinterpret_cast<void*>(first), RoundUp(last - first, pageSize), m_nodes[node]);
+			}
+		}
+
+		m_available = count;
+	}
+
+	/**
+	 * @brief Count of objects in pool
+	 */
+	size_t Count() const
+	{
+		return m_count;
+	}
+
+	/**
+	 * @brief Acquire chunk of memory
+	 *
+	 * Blocks if pool is empty
+	 *
+	 * @return A chunk of memory
+	 */
+	Chunk Acquire()
+	{
+		auto chunk = Chunk(*this);
+
+		Reserve(1);
+		chunk.m_buff = Pop();
+
+		return chunk;
+	}
+
+	/**
+	 * @brief Acquire several chunks of memory at once
+	 *
+	 * Blocks until all of them are available, so concurrent callers can't deadlock
+	 * each holding a part of the chunks they need
+	 *
+	 * @param count - count of chunks. Must not exceed count of objects in pool
+	 *
+	 * @return Chunks of memory
+	 */
+	std::vector<Chunk> Acquire(size_t count)
+	{
+		std::vector<Chunk> chunks;
+		chunks.reserve(count);
+
+		Reserve(count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			chunks.push_back(Chunk(*this));
+			chunks.back().m_buff = Pop();
+		}
+
+		return chunks;
+	}
+
+	/**
+	 * @brief Count of objects currently free
+	 */
+	size_t Available() const
+	{
+		return m_available;
+	}
+
+	/**
+	 * @brief Total time callers waited for objects in nanoseconds
+	 */
+	const std::atomic<int64_t>& WaitTime() const
+	{
+		return m_waitTime;
+	}
+
+private:
+	bool TryReserve(size_t count)
+	{
+		auto available = m_available.load();
+
+		while (available >= count)
+		{
+			if (m_available.compare_exchange_weak(available, available - count))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	 * @brief Reserve free chunks, blocks until there are enough of them
+	 */
+	void Reserve(size_t count)
+	{
+		if (TryReserve(count))
+		{
+			return;
+		}
+
+		ScopedTimer timer(m_waitTime, m_tracer, "pool wait");
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// A release either sees the waiter and notifies under the lock, or happens before the check
+		m_waiters++;
+		m_queueCond.wait(lock, [=](){ return TryReserve(count); });
+		m_waiters--;
+	}
+
+	/**
+	 * @brief Pop chunk of the stacks, there must be a reserved one
+	 *
+	 * Stacks are tried starting from the one of the calling thread node
+	 */
+	char* Pop()
+	{
+		size_t local = 0;
+
+		if (m_nodes.size() > 1)
+		{
+			auto node = std::find(m_nodes.cbegin(), m_nodes.cend(), Numa::CurrentNode());
+			local = (node != m_nodes.cend()) ? node - m_nodes.cbegin() : 0;
+		}
+
+		// The reserved chunk may be in flight to another stack, so keep trying
+		for (size_t i = local;; i = (i + 1) % m_nodes.size())
+		{
+			if (auto chunk = TryPop(m_heads[i]))
+			{
+				return chunk;
+			}
+		}
+	}
+
+	char* TryPop(std::atomic<uint64_t>& stack)
+	{
+		auto head = stack.load(std::memory_order_acquire);
+
+		while (static_cast<uint32_t>(head))
+		{
+			auto index = static_cast<uint32_t>(head) - 1;
+			auto next = m_next[index].load(std::memory_order_relaxed);
+
+			// Tag in the upper half changes on each update, so a stale head can't be swapped in (ABA)
+			if (stack.compare_exchange_weak(head, ((head >> 32) + 1) << 32 | next, std::memory_order_acquire))
+			{
+				return m_buff.Data() + index * m_size;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void Push(size_t index)
+	{
+		auto& stack = m_heads[m_owners[index]];
+		auto head = stack.load(std::memory_order_relaxed);
+		uint64_t top;
+
+		do
+		{
+			m_next[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+			top = ((head >> 32) + 1) << 32 | (index + 1);
+		}
+		while (!stack.compare_exchange_weak(head, top, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	void Release(char* chunk)
+	{
+		Push((chunk - m_buff.Data()) / m_size);
+		m_available++;
+
+		if (m_waiters)
+		{
+			// Waiters may need different count of chunks, so let each of them check
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queueCond.notify_all();
+		}
+	}
+
+	const size_t m_size;
+	const size_t m_count;
+	PageBuffer m_buff; ///< Page aligned for direct I/O, pages are committed on first use
+	std::unique_ptr<std::atomic<uint32_t>[]> m_next; ///< Next chunk index plus one for each chunk in a stack
+	std::vector<uint32_t> m_owners; ///< Index of the node owning each chunk
+	const std::vector<unsigned> m_nodes; ///< Node ids
+	std::unique_ptr<std::atomic<uint64_t>[]> m_heads; ///< Stack of each node: update tag and top chunk index plus one, 0 - empty
+	std::atomic<size_t> m_available { 0 }; ///< Count of free chunks not reserved
+	std::atomic<size_t> m_waiters { 0 };
+	std::mutex m_mutex;
+	std::condition_variable m_queueCond;
+	std::atomic<int64_t> m_waitTime { 0 };
+	Tracer* const m_tracer;
+};
+
+/**
+ * @brief Loser tree
+ *
+ * Tournament tree selecting the smallest of k sources with log2(k) comparisons per element.
+ * Sources are referred to by index, ordering is defined by the 'less' predicate,
+ * which must treat exhausted sources as greater than any other.
+ */
+template <typename Less>
+class LoserTree
+{
+public:
+	LoserTree(size_t count, Less less)
+		: m_less(less)
+			, m_tree(std::max<size_t>(count, 1))
+	{
+		m_tree[0] = Build(1);
+	}
+
+	/**
+	 * @brief Index of the source holding the smallest value
+	 */
+	size_t Winner() const
+	{
+		return m_tree[0];
+	}
+
+	/**
+	 * @brief Replay the tournament
+	 *
+	 * Must be called each time the winner source is advanced
+	 */
+	void Update()
+	{
+		auto winner = m_tree[0];
+
+		for (auto node = (winner + m_tree.size()) / 2; node > 0; node /= 2)
+		{
+			if (m_less(m_tree[node], winner))
+			{
+				std::swap(m_tree[node], winner);
+			}
+		}
+
+		m_tree[0] = winner;
+	}
+
+	/**
+	 * @brief Index of the source holding the smallest value but the winner's
+	 *
+	 * It is the smallest of the losers the winner has beaten on its way up
+	 *
+	 * @return Source index or count of sources if there is only one
+	 */
+	size_t RunnerUp() const
+	{
+		auto runnerUp = m_tree.size();
+
+		for (auto node = (m_tree[0] + m_tree.size()) / 2; node > 0; node /= 2)
+		{
+			if (runnerUp == m_tree.size() || m_less(m_tree[node], runnerUp))
+			{
+				runnerUp = m_tree[node];
+			}
+		}
+
+		return runnerUp;
+	}
+
+private:
+	size_t Build(size_t node)
+	{
+		if (node >= m_tree.size())
+		{
+			return node - m_tree.size();
+		}
+
+		auto winner = Build(node * 2);
+		auto loser = Build(node * 2 + 1);
+
+		if (m_less(loser, winner))
+		{
+			std::swap(winner, loser);
+		}
+
+		m_tree[node] = loser;
+		return winner;
+	}
+
+	Less m_less;
+	std::vector<size_t> m_tree; ///< [0] - winner, [1..k) - losers of internal nodes
+};
+
+template <typename Less>
+auto MakeLoserTree(size_t count, Less less)
+{
+	return LoserTree<Less>(count, less);
+}
+
+/**
+ * @brief Buffered sorted run reader
+ *
+ * Reads run file in blocks, prefetching the next block asynchronously
+ * while elements of the current one are consumed.
+ * Elements are either values or fixed-size records.
+ */
+class RunReader
+{
+public:
+	RunReader(const RunReader&) = delete;
+	RunReader& operator=(const RunReader&) = delete;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param file - run file opened for reading
+	 * @param front, back - blocks to read file to
+	 * @param blockSize - size of each block in bytes, a multiple of element size
+	 * @param elementSize - size of element in bytes
+	 * @param counters - counters of bytes read and read time
+	 */
+	RunReader(std::unique_ptr<File> file, char* front, char* back, size_t blockSize, size_t elementSize,
+		SortCounters& counters)
+		: m_file(std::move(file))
+			, m_front(front)
+			, m_back(back)
+			, m_blockSize(blockSize)
+			, m_elementSize(elementSize)
+			, m_counters(counters)
+	{
+		m_pos = m_front;
+		m_end = m_front + ReadBlock(m_front);
+		Prefetch();
+	}
+
+	bool Empty() const
+	{
+		return m_pos == m_end;
+	}
+
+	/**
+	 * @brief Current element
+	 */
+	const char* Data() const
+	{
+		return m_pos;
+	}
+
+	/**
+	 * @brief Current element as a value
+	 */
+	template <typename T>
+	T Value() const
+	{
+		return *reinterpret_cast<const T*>(m_pos);
+	}
+
+	void Next()
+	{
+		Skip(m_elementSize);
+	}
+
+	/**
+	 * @brief Count of bytes left in the current block
+	 */
+	size_t Available() const
+	{
+		return m_end - m_pos;
+	}
+
+	/**
+	 * @brief Skip bytes of the current block
+	 *
+	 * @param size - count of bytes, at most @ref Available
+	 */
+	void Skip(size_t size)
+	{
+		m_pos += size;
+
+		if (m_pos == m_end)
+		{
+			Refill();
+		}
+	}
+
+	/**
+	 * @brief Read bytes regardless of element boundaries
+	 *
+	 * @param buffer - buffer to read to
+	 * @param size - count of bytes
+	 *
+	 * @return Count of bytes read. Less than size only at the end of run
+	 */
+	size_t Read(char* buffer, size_t size)
+	{
+		size_t done = 0;
+
+		while (done < size && !Empty())
+		{
+			auto part = std::min<size_t>(size - done, m_end - m_pos);
+
+			memcpy(buffer + done, m_pos, part);
+			done += part;
+			Skip(part);
+		}
+
+		return done;
+	}
+
+private:
+	size_t ReadBlock(char* block)
+	{
+		ScopedTimer timer(m_counters.readTime, m_counters.tracer, "read", { { "offset", m_offset } });
+
+		auto size = ReadScheduled(*m_file, block, m_blockSize, m_offset, m_counters);
+		timer.AddArg("bytes", size);
+		m_offset += size;
+		m_counters.bytesRead += size;
+
+		return size;
+	}
+
+	void Prefetch()
+	{
+		auto block = m_back;
+		m_prefetch = std::async(std::launch::async, [=]() { return ReadBlock(block); });
+	}
+
+	void Refill()
+	{
+		auto size = m_prefetch.get();
+
+		if (size)
+		{
+			std::swap(m_front, m_back);
+			m_pos = m_front;
+			m_end = m_front + size;
+			Prefetch();
+		}
+	}
+
+	std::unique_ptr<File> m_file;
+	uint64_t m_offset = 0;
+	char* m_front;
+	char* m_pos = nullptr;
+	char* m_end = nullptr;
+	char* m_back;
+	const size_t m_blockSize;
+	const size_t m_elementSize;
+	SortCounters& m_counters;
+	std::future<size_t> m_prefetch;
+};
+
+/**
+ * @brief Buffered sorted run writer
+ *
+ * Accumulates elements in a block and writes it asynchronously
+ * while the next block is being filled
+ */
+class RunWriter
+{
+public:
+	RunWriter(const RunWriter&) = delete;
+	RunWriter& operator=(const RunWriter&) = delete;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param file - run file opened for writing
+	 * @param front, back - blocks to accumulate elements in
+	 * @param blockSize - size of each block in bytes, a multiple of element size
+	 * @param elementSize - size of element in bytes
+	 * @param counters - counters of bytes written and write time
+	 * @param index - index of the file built as it is written, nullptr - none
+	 */
+	RunWriter(std::unique_ptr<File> file, char* front, char* back, size_t blockSize, size_t elementSize,
+		SortCounters& counters, SparseIndexer* index = nullptr)
+		: m_file(std::move(file))
+			, m_block(front)
+			, m_pos(front)
+			, m_end(front + blockSize)
+			, m_back(back)
+			, m_blockSize(blockSize)
+			, m_elementSize(elementSize)
+			, m_counters(counters)
+			, m_index(index)
+	{
+	}
+
+	~RunWriter() noexcept
+	{
+		if (m_flush.valid())
+		{
+			m_flush.wait();
+		}
+	}
+
+	/**
+	 * @brief Write value, its size must be the element size
+	 */
+	template <typename T>
+	void Write(T value)
+	{
+		*reinterpret_cast<T*>(m_pos) = value;
+		Advance(sizeof(T));
+	}
+
+	/**
+	 * @brief Write element
+	 */
+	void Write(const char* element)
+	{
+		memcpy(m_pos, element, m_elementSize);
+		Advance(m_elementSize);
+	}
+
+	/**
+	 * @brief Write bytes regardless of element boundaries
+	 */
+	void Write(const char* data, size_t size)
+	{
+		while (size)
+		{
+			auto part = std::min<size_t>(size, m_end - m_pos);
+
+			memcpy(m_pos, data, part);
+			data += part;
+			size -= part;
+			Advance(part);
+		}
+	}
+
+	/**
+	 * @brief Write buffered elements and wait for completion
+	 */
+	void Close()
+	{
+		Flush();
+		m_flush.get();
+	}
+
+private:
+	void Advance(size_t size)
+	{
+		m_pos += size;
+
+		if (m_pos == m_end)
+		{
+			Flush();
+		}
+	}
+
+	void Flush()
+	{
+		if (m_flush.valid())
+		{
+			m_flush.get();
+		}
+
+		auto block = m_block;
+		auto size = m_pos - m_block;
+		auto offset = m_offset;
+
+		// Blocks are indexed in order before they are written, while they are still in cache
+		if (m_index)
+		{
+			m_index->Add(block, size);
+		}
+
+		m_flush = std::async(std::launch::async, [=]()
+		{
+			ScopedTimer timer(m_counters.writeTime, m_counters.tracer, "write",
+				{ { "offset", offset }, { "bytes", static_cast<uint64_t>(size) } });
+
+			WriteScheduled(*m_file, block, size, offset, m_counters);
+			m_counters.bytesWritten += size;
+		});
+		m_offset += size;
+
+		std::swap(m_block, m_back);
+		m_pos = m_block;
+		m_end = m_block + m_blockSize;
+	}
+
+	std::unique_ptr<File> m_file;
+	uint64_t m_offset = 0;
+	char* m_block;
+	char* m_pos;
+	char* m_end;
+	char* m_back;
+	const size_t m_blockSize;
+	const size_t m_elementSize;
+	SortCounters& m_counters;
+	SparseIndexer* const m_index;
+	std::future<void> m_flush;
+};
+
+/**
+ * @brief Reader of sorted run compressed by @ref RunCodec
+ *
+ * Decodes a frame at a time, frames are read through a byte-wise @ref RunReader
+ */
+template <typename T>
+class CompressedRunReader
+{
+public:
+	using Key = typename KeyTraits<T>::Key;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * Parameters are the same as of @ref RunReader, element size is of values
+	 */
+	CompressedRunReader(std::unique_ptr<File> file, char* front, char* back, size_t blockSize, size_t,
+		SortCounters& counters)
+		: m_reader(std::move(file), front, back, blockSize, 1, counters)
+	{
+		Decode();
+	}
+
+	bool Empty() const
+	{
+		return m_pos == m_end;
+	}
+
+	T Value() const
+	{
+		return *m_pos;
+	}
+
+	void Next()
+	{
+		if (++m_pos == m_end)
+		{
+			Decode();
+		}
+	}
+
+private:
+	void Decode()
+	{
+		m_pos = m_end = m_values.data();
+
+		auto headerSize = RunCodec::HeaderSize<Key>();
+		auto size = m_reader.Read(m_frame.data(), headerSize);
+
+		if (!size)
+		{
+			return;
+		}
+
+		auto payloadSize = RunCodec::PayloadSize<Key>(m_frame.data());
+
+		if (size != headerSize || m_reader.Read(m_frame.data() + headerSize, payloadSize) != payloadSize)
+		{
+			throw SortException("Compressed sorted run is truncated");
+		}
+
+		auto count = RunCodec::DecodeFrame(m_frame.data(), m_keys.data());
+
+		for (size_t i = 0; i < count; i++)
+		{
+			m_values[i] = KeyTraits<T>::FromKey(m_keys[i]);
+		}
+
+		m_end += count;
+	}
+
+	RunReader m_reader;
+	std::array<char, RunCodec::MaxFrameSize<Key>() + RunCodec::DECODE_PADDING> m_frame;
+	std::array<Key, RunCodec::FRAME_KEY_COUNT> m_keys;
+	std::array<T, RunCodec::FRAME_KEY_COUNT> m_values;
+	const T* m_pos = nullptr;
+	const T* m_end = nullptr;
+};
+
+/**
+ * @brief Writer of sorted run compressed by @ref RunCodec
+ *
+ * Encodes a frame at a time, frames are written through a byte-wise @ref RunWriter
+ */
+template <typename T>
+class CompressedRunWriter
+{
+public:
+	using Key = typename KeyTraits<T>::Key;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * Parameters are the same as of @ref RunWriter, element size is of values
+	 */
+	CompressedRunWriter(std::unique_ptr<File> file, char* front, char* back, size_t blockSize, size_t,
+		SortCounters& counters, SparseIndexer* index = nullptr)
+		: m_writer(std::move(file), front, back, blockSize, 1, counters, index)
+	{
+	}
+
+	void Write(T value)
+	{
+		m_keys[m_count++] = KeyTraits<T>::ToKey(value);
+
+		if (m_count == m_keys.size())
+		{
+			Encode();
+		}
+	}
+
+	/**
+	 * @brief Write buffered values and wait for completion
+	 */
+	void Close()
+	{
+		if (m_count)
+		{
+			Encode();
+		}
+
+		m_writer.Close();
+	}
+
+private:
+	void Encode()
+	{
+		m_writer.Write(m_frame.data(), RunCodec::EncodeFrame(m_keys.data(), m_count, m_frame.data()));
+		m_count = 0;
+	}
+
+	RunWriter m_writer;
+	std::array<Key, RunCodec::FRAME_KEY_COUNT> m_keys;
+	size_t m_count = 0;
+	std::array<char, RunCodec::MaxFrameSize<Key>()> m_frame;
+};
+
+/**
+ * @brief Writer of sorted run of counted values
+ *
+ * Elements are values followed by their counts as uint64_t, packed.
+ * Counts of equal values written in a row are added up into a single element.
+ */
+template <typename T>
+class CountedRunWriter
+{
+public:
+	/**
+	 * @brief Constructor
+	 *
+	 * Parameters are the same as of @ref RunWriter, element size is of counted values
+	 */
+	CountedRunWriter(std::unique_ptr<File> file, char* front, char* back, size_t blockSize, size_t elementSize,
+		SortCounters& counters, SparseIndexer* index = nullptr)
+		: m_writer(std::move(file), front, back, blockSize, elementSize, counters, index)
+	{
+	}
+
+	void Write(T value, uint64_t count = 1)
+	{
+		if (m_count && KeyTraits<T>::ToKey(value) == KeyTraits<T>::ToKey(m_value))
+		{
+			m_count += count;
+			return;
+		}
+
+		Flush();
+		m_value = value;
+		m_count = count;
+	}
+
+	/**
+	 * @brief Write buffered values and wait for completion
+	 */
+	void Close()
+	{
+		Flush();
+		m_writer.Close();
+	}
+
+private:
+	void Flush()
+	{
+		if (!m_count)
+		{
+			return;
+		}
+
+		// Elements are written byte-wise, blocks of a run written at once are not a multiple of their size
+		char element[sizeof(T) + sizeof(uint64_t)];
+		memcpy(element, &m_value, sizeof(T));
+		memcpy(element + sizeof(T), &m_count, sizeof(uint64_t));
+		m_writer.Write(element, sizeof(element));
+	}
+
+	RunWriter m_writer;
+	T m_value {};
+	uint64_t m_count = 0; ///< Count of the pending value, 0 - none
+};
+
+/**
+ * @brief Read a number from file
+ *
+ * @param[in] path - file path
+ *
+ * @return The number or 0 if the file is missing or holds something else (e.g. "max" of cgroup v2)
+ */
+uintmax_t ReadNumber(const fs::path& path)
+{
+	std::ifstream strm(path);
+	uintmax_t number = 0;
+
+	return (strm >> number) ? number : 0;
+}
+
+/**
+ * @brief Get memory size available to the process
+ *
+ * Takes into account reclaimable page cache and cgroup (v1 or v2) memory limit if any
+ *
+ * @return Available memory size in bytes
+ */
+uintmax_t AvailableMemorySize()
+{
+	uintmax_t available = static_cast<uintmax_t>(sysconf(_SC_AVPHYS_PAGES)) * sysconf(_SC_PAGESIZE);
+
+	std::ifstream meminfo("/proc/meminfo");
+	for (std::string key; meminfo >> key; meminfo.ignore(std::numeric_limits<std::streamsize>::max(), '\n'))
+	{
+		uintmax_t size = 0;
+		if (key == "MemAvailable:" && meminfo >> size)
+		{
+			available = size << 10;
+			break;
+		}
+	}
+
+	const std::pair<const char*, const char*> cgroupFiles[] =
+	{
+		{ "/sys/fs/cgroup/memory.max", "/sys/fs/cgroup/memory.current" },
+		{ "/sys/fs/cgroup/memory/memory.limit_in_bytes", "/sys/fs/cgroup/memory/memory.usage_in_bytes" },
+	};
+
+	for (const auto& files : cgroupFiles)
+	{
+		if (auto limit = ReadNumber(files.first))
+		{
+			auto usage = ReadNumber(files.second);
+			available = std::min(available, limit > usage ? limit - usage : 0);
+		}
+	}
+
+	return available;
+}
+
+/**
+ * @brief Wait for all the tasks to complete
+ *
+ * Unlike calling get() one by one, doesn't leave tasks running
+ * behind when one of them throws
+ *
+ * @param tasks - futures of the tasks
+ *
+ * @throw the first exception thrown by the tasks
+ *
+ * @return Results of the tasks
+ */
+template <typename T>
+std::vector<T> WaitAll(std::vector<std::future<T>>& tasks)
+{
+	for (auto& task : tasks)
+	{
+		task.wait();
+	}
+
+	std::vector<T> results;
+	for (auto& task : tasks)
+	{
+		results.push_back(task.get());
+	}
+
+	return results;
+}
+
+void WaitAll(std::vector<std::future<void>>& tasks)
+{
+	for (auto& task : tasks)
+	{
+		task.wait();
+	}
+
+	for (auto& task : tasks)
+	{
+		task.get();
+	}
+}
+
+/**
+ * @brief Memory-mapped file
+ *
+ * Maps the whole file read-only,
+ * or creates (truncates) the file of the given size and maps it for writing
+ */
+class MappedFile
+{
+public:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	 * @brief Map existing file for reading
+	 *
+	 * @param path - file path
+	 * @param size - file size. Must not be 0
+	 */
+	MappedFile(const fs::path& path, uintmax_t size)
+		: MappedFile(path, size, O_RDONLY, PROT_READ)
+	{
+	}
+
+	/**
+	 * @brief Create file and map it for writing
+	 *
+	 * @param path - file path
+	 * @param size - file size. Must not be 0
+	 */
+	static std::unique_ptr<MappedFile> Create(const fs::path& path, uintmax_t size)
+	{
+		return std::unique_ptr<MappedFile>(new MappedFile(path, size, O_RDWR | O_CREAT | O_TRUNC,
+			PROT_READ | PROT_WRITE));
+	}
+
+	~MappedFile() noexcept
+	{
+		if (m_data != MAP_FAILED)
+		{
+			munmap(m_data, m_size);
+		}
+
+		if (m_fd >= 0)
+		{
+			close(m_fd);
+		}
+	}
+
+	char* Data() const
+	{
+		return static_cast<char*>(m_data);
+	}
+
+	/**
+	 * @brief Hint the kernel on access pattern of the mapping range
+	 *
+	 * Hints are advisory, so failures are ignored
+	 */
+	void Advise(uintmax_t offset, uintmax_t size, int advice) const
+	{
+		auto pageOffset = offset - offset % sysconf(_SC_PAGESIZE);
+		madvise(Data() + pageOffset, size + offset - pageOffset, advice);
+	}
+
+private:
+	MappedFile(const fs::path& path, uintmax_t size, int flags, int prot)
+		: m_size(size)
+	{
+		m_fd = open(path.c_str(), flags, 0644);
+
+		if (m_fd < 0 || ((flags & O_CREAT) && ftruncate(m_fd, size)))
+		{
+			throw SortException("Failed to open file " + path.string());
+		}
+
+		m_data = mmap(nullptr, m_size, prot, MAP_SHARED, m_fd, 0);
+
+		if (m_data == MAP_FAILED)
+		{
+			throw SortException("Failed to map file " + path.string());
+		}
+	}
+
+	int m_fd = -1;
+	void* m_data = MAP_FAILED;
+	const uintmax_t m_size;
+};
+
+/**
+ * @brief Blocking queue
+ *
+ * Unbounded queue to pass items between threads.
+ * Once closed, items can't be pushed anymore and pop returns false after the rest of items are popped.
+ */
+template <typename T>
+class BlockingQueue
+{
+public:
+	void Push(T item)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			if (m_closed)
+			{
+				return;
+			}
+
+			m_queue.push(std::move(item));
+		}
+
+		m_cond.notify_one();
+	}
+
+	/**
+	 * @brief Pop item
+	 *
+	 * Blocks until there is an item or the queue is closed
+	 *
+	 * @param[out] item - popped item
+	 *
+	 * @return false if the queue is closed and empty
+	 */
+	bool Pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		m_cond.wait(lock, [this]() { return m_closed || !m_queue.empty(); });
+
+		if (m_queue.empty())
+		{
+			return false;
+		}
+
+		item = std::move(m_queue.front());
+		m_queue.pop();
+
+		return true;
+	}
+
+	void Close()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_closed = true;
+		}
+
+		m_cond.notify_all();
+	}
+
+	size_t Size()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_queue.size();
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::queue<T> m_queue;
+	bool m_closed = false;
+};
+
+/**
+ * @brief A RAII helper class to close queue on scope exit
+ */
+template <typename T>
+class QueueCloser
+{
+public:
+	explicit QueueCloser(BlockingQueue<T>& queue)
+		: m_queue(queue)
+	{
+	}
+
+	~QueueCloser() noexcept
+	{
+		m_queue.Close();
+	}
+
+private:
+	BlockingQueue<T>& m_queue;
+};
+
+/**
+ * @brief Task run periodically on a thread of its own
+ *
+ * Stops on destruction, a running call is completed
+ */
+class PeriodicTask
+{
+public:
+	PeriodicTask(const PeriodicTask&) = delete;
+	PeriodicTask& operator=(const PeriodicTask&) = delete;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param interval - seconds between calls, the first call is made in interval
+	 * @param task - callable without arguments
+	 */
+	PeriodicTask(double interval, std::function<void()> task)
+		: m_thread([this, interval, task]()
+		{
+			auto period = std::chrono::duration<double>(interval);
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			while (!m_cond.wait_for(lock, period, [this]() { return m_stop; }))
+			{
+				lock.unlock();
+				task();
+				lock.lock();
+			}
+		})
+	{
+	}
+
+	~PeriodicTask() noexcept
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+
+		m_cond.notify_all();
+		m_thread.join();
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	bool m_stop = false;
+	std::thread m_thread; ///< Started last, once the rest of members are initialized
+};
+
+/**
+ * @brief Create temp directory
+ *
+ * Creates temp directory with unique name
+ *
+ * @param[in] pathTemplate - directory name template prefix. Must be in form "<prefix>_XXXXXX"
+ *
+ * @return Unique temp directory path
+ */
+fs::path CreateUniqueTempDirectory(const std::string& pathTemplate)
+{
+	// Need to make a copy as mkdtemp returns a pointer to the modified template string
+	std::vector<char> buff(pathTemplate.size() + 1);
+
+	strncpy(buff.data(), pathTemplate.data(), buff.size());
+
+	if (!mkdtemp(buff.data()))
+	{
+		throw SortException("Failed to create temp directory");
+	}
+
+	return buff.data();
+}
+
+/**
+ * @brief External sorter
+ *
+ * Splits input into runs sorted in memory and merges them, possibly in several passes.
+ * Elements are only known by their size here - derived sorters sort runs in memory
+ * and merge run files.
+ */
+class ExternalSorter
+{
+public:
+	ExternalSorter(const ExternalSorter&) = delete;
+	ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+	virtual ~ExternalSorter() noexcept
+	{
+		// Runs of a failed resumable sort are left for the next attempt
+		if (m_resume && !m_done)
+		{
+			return;
+		}
+
+		std::error_code ec;
+		for (const auto& tempDirPath : m_tempDirPaths)
+		{
+			if (fs::exists(tempDirPath, ec))
+			{
+				fs::remove_all(tempDirPath, ec);
+			}
+		}
+	}
+
+	void Sort()
+	{
+		// Index of a previous output must not outlive it if this sort fails
+		if (m_outputIndex)
+		{
+			fs::remove(m_outFilePath.string() + SPARSE_INDEX_FILE_SUFFIX);
+		}
+
+		try
+		{
+			std::unique_ptr<PeriodicTask> reporter;
+
+			if (m_statsCallback && m_statsInterval > 0)
+			{
+				reporter = std::make_unique<PeriodicTask>(m_statsInterval, [this]() { ReportStats(); });
+			}
+
+			RunPhases();
+		}
+		catch (...)
+		{
+			// Trace of a failed sort shows where it failed, the sort error is reported rather than the trace one
+			if (m_tracer)
+			{
+				try
+				{
+					m_tracer->Write();
+				}
+				catch (...)
+				{
+				}
+			}
+
+			throw;
+		}
+
+		if (m_outputIndex)
+		{
+			auto contents = m_outputIndex->Contents();
+			auto file = File::Open(m_outFilePath.string() + SPARSE_INDEX_FILE_SUFFIX, File::Mode::Write,
+				IoBackend::Buffered);
+			file->Write(contents.data(), contents.size(), 0);
+		}
+
+		m_done = true;
+		ReportStats();
+
+		if (m_tracer)
+		{
+			m_tracer->Write();
+		}
+	}
+
+protected:
+	/**
+	 * @brief Sorted run
+	 *
+	 * A temp file holding sorted elements of the contiguous input range
+	 */
+	struct Run
+	{
+		uintmax_t offset;
+		uintmax_t size;
+		fs::path fileName;
+	};
+
+	void RunPhases()
+	{
+		auto phaseStart = m_startTime;
+
+		// Streamed input can't be scanned before sorting, nor read again if there are too many distinct values to count
+		if (m_adaptive && !m_inStream && CopySortedInput())
+		{
+			CompletePhase(SortPhase::RunGeneration, phaseStart);
+			return;
+		}
+
+		if (m_counting != CountingMode::Off && !m_inStream && SortByCounting())
+		{
+			CompletePhase(SortPhase::RunGeneration, phaseStart);
+			return;
+		}
+
+		if (!m_inStream && FitsInMemory())
+		{
+			SortInMemory();
+			CompletePhase(SortPhase::RunGeneration, phaseStart);
+			return;
+		}
+
+		std::vector<unsigned> nodes;
+		if (m_numaNodes.size() > 1)
+		{
+			for (const auto& node : m_numaNodes)
+			{
+				nodes.push_back(node.id);
+			}
+		}
+
+		m_memPool = std::make_unique<SimpleBlockingMemoryPool>(m_memoryChunkSize, m_poolDepth, m_hugePages, nodes,
+			m_tracer.get());
+
+		if (!m_inStream && m_inFileSize <= m_memoryChunkSize)
+		{
+			CreateSortedChunk(0, m_inFileSize, m_outFilePath);
+			CompletePhase(SortPhase::RunGeneration, phaseStart);
+			return;
+		}
+
+		CreateTempDirectories();
+
+		auto runs = CreateSortedRuns();
+
+		// Streamed input size is only known after reading it
+		if (runs.empty() || runs.front().fileName == m_outFilePath)
+		{
+			if (runs.empty())
+			{
+				WriteChunk(nullptr, 0, m_outFilePath);
+			}
+
+			CompletePhase(SortPhase::RunGeneration, phaseStart);
+			return;
+		}
+
+		m_mergeReadStart = m_counters.bytesRead.load();
+		m_mergeVolume = MergeVolume(runs);
+		phaseStart = CompletePhase(SortPhase::RunGeneration, phaseStart);
+
+		runs = CascadeMergeRuns(std::move(runs));
+		MergeRuns(runs.cbegin(), runs.cend(), m_outFilePath, m_memPool->Count());
+		CompletePhase(SortPhase::Merge, phaseStart);
+	}
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param inFilePath, outFilePath, options - see @ref SortBlobT
+	 * @param elementSize - size of element in bytes, input size must be a multiple of it
+	 * @param sortMemoryChunkCount - count of memory chunks needed to sort a run, see @ref SortRun
+	 * @param source - source streamed in place of the input file, which path only names it then, nullptr - none
+	 * @param sink - sink streamed to in place of the output file, which path only names it then, nullptr - none
+	 * @param outputIndex - index of the output built as it is written, see @ref CreateOutputIndex
+	 */
+	ExternalSorter(const std::string& inFilePath, const std::string& outFilePath, const SortOptions& options,
+		size_t elementSize, size_t sortMemoryChunkCount, SortSource* source, SortSink* sink,
+		std::unique_ptr<SparseIndexer> outputIndex)
+		: m_inFilePath(inFilePath)
+			, m_outFilePath(outFilePath)
+			, m_source(source)
+			, m_sink(sink)
+			, m_inStream(m_source || IsStream(inFilePath))
+			, m_outStream(m_sink || IsStream(outFilePath))
+			, m_inFileSize(m_inStream ? 0 : fs::file_size(inFilePath))
+			, m_elementSize(elementSize)
+			, m_runElementSize(elementSize + (options.duplicates == DuplicateMode::Count ? sizeof(uint64_t) : 0))
+			, m_mergeFanIn(options.mergeFanIn)
+			, m_sortKernel(options.sortKernel)
+			, m_parallelRuns(options.parallelRuns)
+			, m_ioBackend(options.ioBackend)
+			, m_hugePages(options.hugePages)
+			, m_numaNodes(options.numa ? Numa::Nodes() : std::vector<Numa::Node>())
+			, m_sortMemoryChunkCount(sortMemoryChunkCount)
+			, m_memoryBudget(options.memoryBudget ? options.memoryBudget :
+				AvailableMemorySize() / AUTO_MEMORY_BUDGET_DIVISOR)
+			, m_memoryChunkSize(CalcMemoryChunkSize(options))
+			, m_poolDepth(CalcPoolDepth(options))
+			, m_threadPool(options.threadCount, PinWorkerThread())
+			, m_inMap(MapInputFile(options))
+			, m_inFiles(inFilePath, options.ioBackend)
+			, m_phaseCallback(options.phaseCallback)
+			, m_statsCallback(options.statsCallback)
+			, m_statsInterval(options.statsInterval)
+			, m_ioScheduler(options.deviceStreams, options.bandwidthLimits)
+			, m_tracer(options.traceFile.empty() ? nullptr : std::make_unique<Tracer>(options.traceFile))
+			, m_tempRoots(TempRoots(options))
+			, m_tempPlacement(options.tempPlacement)
+			, m_counting(options.counting)
+			, m_adaptive(options.adaptive)
+			, m_resume(options.resume)
+			, m_limit(options.limit)
+			, m_duplicates(options.duplicates)
+			, m_outputIndex(std::move(outputIndex))
+	{
+		if (m_resume && m_inStream)
+		{
+			throw SortException("Sort of streamed input can't be resumed");
+		}
+
+		if (m_outputIndex && m_outStream)
+		{
+			throw SortException("Streamed output can't be indexed");
+		}
+
+		if (m_inFileSize % m_elementSize)
+		{
+			throw SortException("File size is not a multiple of the element size");
+		}
+
+		if (m_mergeFanIn < 2)
+		{
+			throw SortException("Merge fan-in must be at least 2");
+		}
+
+		m_counters.ioScheduler = &m_ioScheduler;
+		m_counters.tracer = m_tracer.get();
+	}
+
+	/**
+	 * @brief Sort run in memory
+	 *
+	 * Elements not selected for the output are dropped, see @ref SortOptions::limit and @ref SortOptions::rangeLow
+	 *
+	 * @param[in] input - elements to sort, either the first chunk or a separate buffer (e.g. mapped input)
+	 * @param[in] chunks - memory chunks of count passed to the constructor
+	 * @param[in,out] size - size of elements in bytes, of the sorted ones on return
+	 * @param[in] parallel - sort using all the worker threads. Must not be called from worker threads then
+	 *
+	 * @return Pointer to sorted elements - the beginning of one of the chunks
+	 */
+	virtual char* SortRun(const char* input, std::vector<SimpleBlockingMemoryPool::Chunk>& chunks, uintmax_t& size,
+		bool parallel) = 0;
+
+	/**
+	 * @brief Merge sorted runs into a file
+	 *
+	 * @param runs - runs to merge
+	 * @param result - path of file to write merged run to
+	 * @param memoryChunkCount - count of memory chunks to split into I/O blocks
+	 */
+	virtual void MergeChunks(const std::vector<Run>& runs, const fs::path& result, size_t memoryChunkCount) = 0;
+
+	/**
+	 * @brief Format of run files, e.g. element type and encoding. A resumed sort reuses runs of the same format only
+	 */
+	virtual std::string RunFormat() const = 0;
+
+	/**
+	 * @brief Check if the whole input can be sorted in memory at once by @ref SortInMemory
+	 */
+	virtual bool FitsInMemory() const
+	{
+		return false;
+	}
+
+	/**
+	 * @brief Sort the whole input in memory bypassing the memory pool
+	 */
+	virtual void SortInMemory()
+	{
+	}
+
+	/**
+	 * @brief Copy input sorted as a whole to the output bypassing the memory pool
+	 *
+	 * @return false if the input is not sorted, so the regular sort has to follow
+	 */
+	virtual bool CopySortedInput()
+	{
+		return false;
+	}
+
+	/**
+	 * @brief Sort input by counting its values bypassing the memory pool, see @ref CountingMode
+	 *
+	 * @return false if the input is not sorted, so the regular sort has to follow
+	 */
+	virtual bool SortByCounting()
+	{
+		return false;
+	}
+
+	uintmax_t CalcMemoryChunkSize(const SortOptions& options) const
+	{
+		// Two chunks per CPU core by default, or as many as sorting a run takes. If each run is sorted
+		// by all the cores, a run being sorted with its scratch, the next one being read and the previous
+		// one being written. A whole count of elements each, a whole count of direct I/O blocks if large enough.
+		auto poolDepth = options.poolDepth ? options.poolDepth : m_parallelRuns ? m_sortMemoryChunkCount + 2 :
+			std::max(std::thread::hardware_concurrency(), 1u) * std::max<size_t>(m_sortMemoryChunkCount, 2);
+		auto size = options.chunkSize ? options.chunkSize : m_memoryBudget / poolDepth;
+		auto alignment = std::lcm<uintmax_t>(m_elementSize, IO_BLOCK_ALIGNMENT);
+
+		size -= size % (size >= alignment ? alignment : m_elementSize);
+
+		if (!size)
+		{
+			throw SortException("Memory budget is too small for the pool depth");
+		}
+
+		return size;
+	}
+
+	size_t CalcPoolDepth(const SortOptions& options) const
+	{
+		size_t depth = options.poolDepth ? options.poolDepth : m_memoryBudget / m_memoryChunkSize;
+
+		if (depth < m_sortMemoryChunkCount)
+		{
+			throw SortException("Memory budget is too small for the chunk size");
+		}
+
+		if (m_memoryChunkSize * depth > m_memoryBudget)
+		{
+			throw SortException("Chunk size and pool depth exceed memory budget");
+		}
+
+		return depth;
+	}
+
+	/**
+	 * @brief Worker thread initializer spreading workers over NUMA nodes round-robin
+	 *
+	 * A run is read, sorted and written by the same worker, so its memory chunks are taken from the pool
+	 * part of the worker node. Merges take chunks wherever they run, reading runs of all the nodes anyway.
+	 */
+	ThreadPool::Initializer PinWorkerThread() const
+	{
+		if (m_numaNodes.size() < 2)
+		{
+			return nullptr;
+		}
+
+		auto nodes = m_numaNodes;
+		return [nodes](size_t index) { Numa::PinThread(nodes[index % nodes.size()].cpus); };
+	}
+
+	std::unique_ptr<MappedFile> MapInputFile(const SortOptions& options) const
+	{
+		// Empty file can't be mapped, and there is nothing to read anyway. Neither can a stream
+		if (!options.mapInput || m_inStream || !m_inFileSize)
+		{
+			return nullptr;
+		}
+
+		auto map = std::make_unique<MappedFile>(m_inFilePath, m_inFileSize);
+
+		// Runs are read in order, but in parallel - let the kernel read ahead of all of them
+		map->Advise(0, m_inFileSize, MADV_SEQUENTIAL);
+		map->Advise(0, std::min(m_inFileSize, m_memoryChunkSize * m_poolDepth), MADV_WILLNEED);
+
+		return map;
+	}
+
+	/**
+	 * @brief Open input, output or temp file
+	 *
+	 * Input of a source and output to a sink are opened as their files, other paths by @ref File::Open
+	 */
+	std::unique_ptr<File> OpenFile(const fs::path& path, File::Mode mode, IoBackend backend) const
+	{
+		if (m_source && mode == File::Mode::Read && path == m_inFilePath)
+		{
+			return std::make_unique<SourceFile>(*m_source);
+		}
+
+		if (m_sink && mode == File::Mode::Write && path == m_outFilePath)
+		{
+			return std::make_unique<SinkFile>(*m_sink);
+		}
+
+		return File::Open(path, mode, backend);
+	}
+
+	/**
+	 * @brief Index of the file built as it is written
+	 *
+	 * @return Output index if the file is the output and it is indexed, nullptr otherwise
+	 */
+	SparseIndexer* IndexOf(const fs::path& path) const
+	{
+		return (path == m_outFilePath) ? m_outputIndex.get() : nullptr;
+	}
+
+	void ReadChunk(char* chunk, uintmax_t offset, uintmax_t size)
+	{
+		ScopedTimer timer(m_counters.readTime, m_counters.tracer, "read", { { "offset", offset }, { "bytes", size } });
+		auto file = m_inFiles.Acquire();
+
+		if (ReadScheduled(*file, chunk, size, offset, m_counters) != size)
+		{
+			throw SortException("Failed to read input chunk");
+		}
+
+		m_counters.bytesRead += size;
+	}
+
+	/**
+	 * @brief Read the whole input block by block in order
+	 *
+	 * @param func - function taking block and its size, a multiple of element size. Returns false to stop
+	 *
+	 * @return false if stopped
+	 */
+	template <typename F>
+	bool ForEachInputBlock(F func)
+	{
+		if (m_inMap)
+		{
+			for (uintmax_t offset = 0; offset < m_inFileSize; offset += SCAN_BLOCK_SIZE)
+			{
+				if (!func(m_inMap->Data() + offset, std::min<uintmax_t>(SCAN_BLOCK_SIZE, m_inFileSize - offset)))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		auto buffer = AllocateAligned<char>(SCAN_BLOCK_SIZE * 2);
+		RunReader reader(File::Open(m_inFilePath, File::Mode::Read, m_ioBackend), buffer.get(),
+			buffer.get() + SCAN_BLOCK_SIZE, SCAN_BLOCK_SIZE, m_elementSize, m_counters);
+
+		for (; !reader.Empty(); reader.Skip(reader.Available()))
+		{
+			if (!func(reader.Data(), reader.Available()))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	static std::vector<fs::path> TempRoots(const SortOptions& options)
+	{
+		if (options.tempDirectories.empty())
+		{
+			return { fs::temp_directory_path() };
+		}
+
+		return { options.tempDirectories.cbegin(), options.tempDirectories.cend() };
+	}
+
+	/**
+	 * @brief Create a unique temp directory in each of the temp directories
+	 *
+	 * Temp directories of a resumable sort are named after the sort instead,
+	 * so that the next attempt finds them and resumes from the manifest
+	 */
+	void CreateTempDirectories()
+	{
+		if (!m_resume)
+		{
+			for (const auto& root : m_tempRoots)
+			{
+				m_tempDirPaths.push_back(CreateUniqueTempDirectory(root / "blobsort_XXXXXX"));
+			}
+
+			return;
+		}
+
+		auto header = ManifestHeader();
+		std::stringstream name;
+
+		name << "blobsort_" << std::hex << std::setfill('0') << std::setw(16) << std::hash<std::string>()(header);
+
+		for (const auto& root : m_tempRoots)
+		{
+			m_tempDirPaths.push_back(root / name.str());
+			fs::create_directories(m_tempDirPaths.back());
+		}
+
+		LoadManifest(header);
+	}
+
+	/**
+	 * @brief Identity of a resumable sort, the manifest of the previous attempt is only used if it matches
+	 */
+	std::string ManifestHeader() const
+	{
+		std::stringstream strm;
+
+		strm << MANIFEST_SIGNATURE << '\n'
+			<< "input " << fs::absolute(m_inFilePath).string() << '\n'
+			<< "size " << m_inFileSize << '\n'
+			<< "modified " << fs::last_write_time(m_inFilePath).time_since_epoch().count() << '\n'
+			<< "format " << RunFormat() << ' ' << m_elementSize << '\n';
+
+		return strm.str();
+	}
+
+	/**
+	 * @brief Load runs of the previous attempt of a resumable sort and start the manifest of this one
+	 *
+	 * The manifest is a text file in the first temp directory. The header identifies the sort,
+	 * and each next line records a run file complete on disk:
+	 *
+	 *     run <offset> <size> <file size> <path>
+	 *
+	 * A run supersedes the ones recorded before it within its input range - the runs merged into it.
+	 * Runs with a file missing or of another size are dropped, so their input is sorted again.
+	 * Files of the dropped runs are removed.
+	 */
+	void LoadManifest(const std::string& header)
+	{
+		auto path = m_tempDirPaths.front() / MANIFEST_FILE_NAME;
+		std::map<uintmax_t, std::pair<Run, uintmax_t>> runs; ///< Runs and their file sizes by offset
+		std::ifstream in(path);
+		std::string text(header.size(), '\0');
+
+		if (in.read(&text[0], text.size()) && text == header)
+		{
+			std::string tag;
+			Run run;
+			uintmax_t fileSize = 0;
+
+			while (in >> tag >> run.offset >> run.size >> fileSize && tag == "run" && in.get() == ' ')
+			{
+				std::string fileName;
+				std::getline(in, fileName);
+
+				// Ranges of runs never cross, the runs starting within the range are merged into this one
+				runs.erase(runs.lower_bound(run.offset), runs.lower_bound(run.offset + run.size));
+
+				run.fileName = fileName;
+				runs[run.offset] = { run, fileSize };
+			}
+		}
+
+		std::vector<fs::path> kept { path };
+
+		for (const auto& entry : runs)
+		{
+			std::error_code ec;
+			const auto& run = entry.second.first;
+
+			if (fs::file_size(run.fileName, ec) == entry.second.second && !ec)
+			{
+				m_resumedRuns.push_back(run);
+				kept.push_back(run.fileName);
+			}
+		}
+
+		for (const auto& dir : m_tempDirPaths)
+		{
+			for (const auto& file : fs::directory_iterator(dir))
+			{
+				if (std::find(kept.cbegin(), kept.cend(), file.path()) == kept.cend())
+				{
+					fs::remove(file.path());
+				}
+			}
+		}
+
+		// The manifest of the previous attempt is replaced at once, so a failure can't lose it
+		auto newPath = path;
+		newPath += ".new";
+
+		m_manifest.open(newPath.string(), std::ios::trunc);
+		m_manifest << header << std::flush;
+
+		for (const auto& run : m_resumedRuns)
+		{
+			RecordRun(run);
+		}
+
+		fs::rename(newPath, path);
+	}
+
+	/**
+	 * @brief Record run file complete on disk in the manifest of a resumable sort
+	 */
+	void RecordRun(const Run& run)
+	{
+		if (!m_manifest.is_open())
+		{
+			return;
+		}
+
+		auto fileSize = fs::file_size(run.fileName);
+		std::unique_lock<std::mutex> lock(m_manifestMutex);
+
+		m_manifest << "run " << run.offset << ' ' << run.size << ' ' << fileSize << ' ' << run.fileName.string()
+			<< std::endl;
+
+		if (!m_manifest)
+		{
+			throw SortException("Failed to write sort manifest");
+		}
+	}
+
+	/**
+	 * @brief Runs to create - input ranges not covered by resumed runs split by the memory chunk size
+	 */
+	std::vector<Run> PendingRuns() const
+	{
+		std::vector<Run> runs;
+		uintmax_t offset = 0;
+
+		auto split = [&](uintmax_t end)
+		{
+			for (; offset < end; offset += runs.back().size)
+			{
+				runs.push_back({ offset, std::min(m_memoryChunkSize, end - offset), fs::path() });
+			}
+		};
+
+		for (const auto& run : m_resumedRuns)
+		{
+			split(run.offset);
+			offset = run.offset + run.size;
+		}
+
+		split(m_inFileSize);
+
+		return runs;
+	}
+
+	/**
+	 * @brief Choose temp directory for the next run file
+	 *
+	 * Run files go to temp directories round-robin, so the files merged at once are spread over them,
+	 * or to the one with the most free space
+	 */
+	const fs::path& NextTempDirectory()
+	{
+		auto next = m_nextTempDir++ % m_tempDirPaths.size();
+
+		if (m_tempPlacement == TempPlacement::FreeSpace)
+		{
+			uintmax_t maxAvailable = 0;
+
+			// Start from the round-robin choice, so directories with equal free space take turns
+			for (size_t i = 0; i < m_tempDirPaths.size(); i++)
+			{
+				auto index = (next + i) % m_tempDirPaths.size();
+				std::error_code ec;
+				auto available = fs::space(m_tempDirPaths[index], ec).available;
+
+				if (!ec && available > maxAvailable)
+				{
+					maxAvailable = available;
+					next = index;
+				}
+			}
+		}
+
+		return m_tempDirPaths[next];
+	}
+
+	fs::path CreateChunkFileName(uintmax_t offset, uintmax_t size)
+	{
+		std::stringstream strm;
+
+		strm << std::hex << std::setfill('0')
+			<< std::setw(8) << offset << ':'
+			<< std::setw(8) << size;
+
+		return NextTempDirectory() / strm.str();
+	}
+
+	/**
+	 * @brief Sort values
+	 *
+	 * @param input - values to sort, either data, scratch or a separate buffer (e.g. mapped input)
+	 * @param data - buffer to sort values in
+	 * @param scratch - scratch buffer of the same size, only used by radix sort
+	 * @param count - count of values
+	 *
+	 * @return Pointer to sorted values - either data or scratch
+	 */
+	template <typename T>
+	T* SortValues(const T* input, T* data, T* scratch, size_t count)
+	{
+		switch (m_sortKernel)
+		{
+		case SortKernel::Radix:
+			return RadixSort(input, data, scratch, count);
+		case SortKernel::Std:
+			break;
+		}
+
+		if (input != data)
+		{
+			std::copy(input, input + count, data);
+		}
+
+		std::sort(data, data + count, KeyTraits<T>::Less);
+		return data;
+	}
+
+	fs::path CreateSortedChunk(uintmax_t offset, uintmax_t size, const fs::path& fileName)
+	{
+		auto chunks = m_memPool->Acquire(m_sortMemoryChunkCount);
+		const char* input = chunks[0];
+
+		if (m_inMap)
+		{
+			input = m_inMap->Data() + offset;
+		}
+		else if (m_parallelRuns)
+		{
+			ReadInParallel(chunks[0], offset, size);
+		}
+		else
+		{
+			ReadChunk(chunks[0], offset, size);
+		}
+
+		const char* sorted = nullptr;
+		auto sortedSize = size;
+		{
+			ScopedTimer timer(m_counters.sortTime, m_counters.tracer, "sort", { { "offset", offset }, { "bytes", size } });
+			sorted = SortRun(input, chunks, sortedSize, m_parallelRuns);
+		}
+
+		auto chunkFileName = fileName.empty() ? CreateChunkFileName(offset, size) : fileName;
+
+		if (!fileName.empty())
+		{
+			WriteOutput(sorted, sortedSize, fileName);
+		}
+		else
+		{
+			WriteRun(sorted, sortedSize, chunkFileName);
+		}
+
+		CountRun(size);
+
+		return chunkFileName;
+	}
+
+	void WriteChunk(const char* chunk, uintmax_t size, const fs::path& fileName)
+	{
+		ScopedTimer timer(m_counters.writeTime, m_counters.tracer, "write", { { "bytes", size } });
+
+		if (auto index = IndexOf(fileName))
+		{
+			index->Add(chunk, size);
+		}
+
+		WriteScheduled(*OpenFile(fileName, File::Mode::Write, m_ioBackend), chunk, size, 0, m_counters);
+		m_counters.bytesWritten += size;
+	}
+
+	/**
+	 * @brief Count run created by run generation
+	 *
+	 * @param size - size of input sorted into the run in bytes
+	 */
+	void CountRun(uintmax_t size)
+	{
+		m_counters.sortedBytes += size;
+		m_counters.runCount++;
+	}
+
+	/**
+	 * @brief Write sorted run to temp file
+	 *
+	 * Derived sorters may store runs in their own format, that their @ref MergeChunks reads
+	 */
+	virtual void WriteRun(const char* run, uintmax_t size, const fs::path& fileName)
+	{
+		WriteChunk(run, size, fileName);
+	}
+
+	/**
+	 * @brief Write elements sorted at once to the output file
+	 *
+	 * Derived sorters may output elements in their own format, the same as their @ref MergeChunks do
+	 */
+	virtual void WriteOutput(const char* sorted, uintmax_t size, const fs::path& fileName)
+	{
+		WriteChunk(sorted, size, fileName);
+	}
+
+	/**
+	 * @brief Create runs sorted by all the worker threads
+	 *
+	 * Runs are sorted one by one on the calling thread, while a reader thread reads the next run
+	 * and a writer thread writes the previous one. Stages pass memory chunks to each other,
+	 * so the pool depth limits how far they can get ahead.
+	 * The reader only acquires a chunk for the next run after the sorter got the rest of chunks
+	 * for the current one, so they can't deadlock taking the last chunks of the pool.
+	 *
+	 * @param runs - runs to create, their file names are filled in
+	 */
+	void CreateSortedRunsPipelined(std::vector<Run>& runs)
+	{
+		struct SortedRun
+		{
+			size_t index;
+			SimpleBlockingMemoryPool::Chunk chunk;
+			const char* data;
+			uintmax_t size; ///< Size of elements in bytes, of the sorted ones once sorted
+		};
+
+		BlockingQueue<std::unique_ptr<SortedRun>> readQueue;
+		BlockingQueue<std::unique_ptr<SortedRun>> writeQueue;
+		BlockingQueue<bool> readPermits;
+
+		for (auto& run : runs)
+		{
+			run.fileName = CreateChunkFileName(run.offset, run.size);
+		}
+
+		auto reader = std::async(std::launch::async, [&]()
+		{
+			QueueCloser closer(readQueue);
+			bool permit = true;
+
+			for (size_t i = 0; i < runs.size() && (!i || readPermits.Pop(permit)); i++)
+			{
+				auto run = std::make_unique<SortedRun>(SortedRun { i, m_memPool->Acquire(), nullptr, runs[i].size });
+
+				if (m_inMap)
+				{
+					run->data = m_inMap->Data() + runs[i].offset;
+					m_inMap->Advise(runs[i].offset, runs[i].size, MADV_WILLNEED);
+				}
+				else
+				{
+					ReadChunk(run->chunk, runs[i].offset, runs[i].size);
+					run->data = run->chunk;
+				}
+
+				readQueue.Push(std::move(run));
+				m_counters.readQueueDepth = readQueue.Size();
+			}
+		});
+
+		auto writer = std::async(std::launch::async, [&]()
+		{
+			std::unique_ptr<SortedRun> run;
+
+			try
+			{
+				while (writeQueue.Pop(run))
+				{
+					m_counters.writeQueueDepth = writeQueue.Size();
+
+					WriteRun(run->data, run->size, runs[run->index].fileName);
+					CountRun(runs[run->index].size);
+					RecordRun(runs[run->index]);
+
+					// Don't hold the chunk while waiting for the next run
+					run.reset();
+				}
+			}
+			catch (...)
+			{
+				// Return chunks of the rest of runs to pool, so the sorter doesn't block on it
+				writeQueue.Close();
+				while (writeQueue.Pop(run))
+				{
+				}
+
+				throw;
+			}
+		});
+
+		try
+		{
+			QueueCloser closer(writeQueue);
+			QueueCloser permitsCloser(readPermits);
+
+			for (std::unique_ptr<SortedRun> run; readQueue.Pop(run);)
+			{
+				m_counters.readQueueDepth = readQueue.Size();
+
+				std::vector<SimpleBlockingMemoryPool::Chunk> chunks;
+				chunks.push_back(std::move(run->chunk));
+
+				for (auto& chunk : m_memPool->Acquire(m_sortMemoryChunkCount - 1))
+				{
+					chunks.push_back(std::move(chunk));
+				}
+
+				readPermits.Push(true);
+
+				const char* sorted = nullptr;
+				{
+					ScopedTimer timer(m_counters.sortTime, m_counters.tracer, "sort",
+						{ { "run", run->index }, { "bytes", run->size } });
+					sorted = SortRun(run->data, chunks, run->size, true);
+				}
+
+				// Let the writer have the chunk holding sorted elements, the rest go back to pool
+				auto holder = std::find_if(chunks.begin(), chunks.end(),
+					[=](SimpleBlockingMemoryPool::Chunk& chunk) { return chunk.Data() == sorted; });
+				auto sortedRun = std::make_unique<SortedRun>(SortedRun { run->index, std::move(*holder), sorted,
+					run->size });
+
+				run.reset();
+				chunks.clear();
+				writeQueue.Push(std::move(sortedRun));
+				m_counters.writeQueueDepth = writeQueue.Size();
+			}
+		}
+		catch (...)
+		{
+			// Drain the reader, so it doesn't block on the queue or pool
+			readQueue.Close();
+			reader.wait();
+			writer.wait();
+			throw;
+		}
+
+		reader.get();
+		writer.get();
+	}
+
+	/**
+	 * @brief Create runs of input streamed from standard input
+	 *
+	 * Input is read sequentially on the calling thread a run at a time, and each run is sorted
+	 * and written by a worker, or by all the workers on the calling thread for parallel runs.
+	 * Memory chunks of a run are acquired before reading it, so the pool depth limits
+	 * how far the reader can get ahead of the workers.
+	 * Input size is known when the end of stream is reached.
+	 *
+	 * @return Runs, or a single run of the output if the stream is shorter than a run
+	 */
+	std::vector<Run> CreateStreamRuns()
+	{
+		std::vector<Run> runs;
+		std::vector<std::future<void>> tasks;
+		std::atomic<bool> failed(false);
+		auto file = OpenFile(m_inFilePath, File::Mode::Read, m_ioBackend);
+		uintmax_t offset = 0;
+
+		try
+		{
+			while (!failed)
+			{
+				auto chunks = m_memPool->Acquire(m_sortMemoryChunkCount);
+				size_t size = 0;
+				{
+					ScopedTimer timer(m_counters.readTime, m_counters.tracer, "read", { { "offset", offset } });
+					size = ReadScheduled(*file, chunks[0], m_memoryChunkSize, offset, m_counters);
+					timer.AddArg("bytes", size);
+				}
+
+				m_counters.bytesRead += size;
+
+				if (size % m_elementSize)
+				{
+					throw SortException("Input size is not a multiple of the element size");
+				}
+
+				if (!size)
+				{
+					break;
+				}
+
+				// Stream ending within the first run is sorted right to the output
+				auto single = !offset && size < m_memoryChunkSize;
+				runs.push_back({ offset, size, single ? m_outFilePath : CreateChunkFileName(offset, size) });
+				offset += size;
+
+				auto createRun = [&, chunks = std::move(chunks), run = runs.back()](bool parallel) mutable
+				{
+					// The task holding the chunks lives as long as its future, return them to pool on exit
+					auto runChunks = std::move(chunks);
+
+					// Don't waste time on the rest of the runs when one of them has failed
+					if (failed)
+					{
+						return;
+					}
+
+					const char* sorted = nullptr;
+					auto sortedSize = run.size;
+					{
+						ScopedTimer timer(m_counters.sortTime, m_counters.tracer, "sort",
+							{ { "offset", run.offset }, { "bytes", run.size } });
+						sorted = SortRun(runChunks[0], runChunks, sortedSize, parallel);
+					}
+
+					if (run.fileName == m_outFilePath)
+					{
+						WriteOutput(sorted, sortedSize, run.fileName);
+					}
+					else
+					{
+						WriteRun(sorted, sortedSize, run.fileName);
+					}
+
+					CountRun(run.size);
+				};
+
+				if (m_parallelRuns)
+				{
+					createRun(true);
+				}
+				else
+				{
+					tasks.push_back(m_threadPool.Submit([&, createRun = std::move(createRun)]() mutable
+					{
+						try
+						{
+							createRun(false);
+						}
+						catch (...)
+						{
+							failed = true;
+							throw;
+						}
+					}));
+				}
+
+				// Short read is the end of stream
+				if (size < m_memoryChunkSize)
+				{
+					break;
+				}
+			}
+		}
+		catch (...)
+		{
+			failed = true;
+			for (auto& task : tasks)
+			{
+				task.wait();
+			}
+
+			throw;
+		}
+
+		WaitAll(tasks);
+		m_inFileSize = offset;
+
+		return runs;
+	}
+
+	std::vector<Run> CreateSortedRuns()
+	{
+		if (m_inStream)
+		{
+			return CreateStreamRuns();
+		}
+
+		for (const auto& run : m_resumedRuns)
+		{
+			CountRun(run.size);
+		}
+
+		auto runs = PendingRuns();
+
+		if (m_parallelRuns)
+		{
+			CreateSortedRunsPipelined(runs);
+		}
+		else
+		{
+			std::atomic<bool> failed(false);
+			std::vector<std::future<void>> tasks;
+
+			for (auto& run : runs)
+			{
+				tasks.push_back(m_threadPool.Submit([&]()
+				{
+					// Don't waste time on the rest of the runs when one of them has failed
+					if (failed)
+					{
+						return;
+					}
+
+					try
+					{
+						run.fileName = CreateSortedChunk(run.offset, run.size, fs::path());
+						RecordRun(run);
+					}
+					catch (...)
+					{
+						failed = true;
+						throw;
+					}
+				}));
+			}
+
+			WaitAll(tasks);
+		}
+
+		runs.insert(runs.end(), m_resumedRuns.cbegin(), m_resumedRuns.cend());
+		std::sort(runs.begin(), runs.end(), [](const Run& left, const Run& right) { return left.offset < right.offset; });
+
+		return runs;
+	}
+
+	/**
+	 * @brief Split memory chunks into equally sized blocks
+	 *
+	 * @param[in] chunks - memory chunks acquired from pool
+	 * @param[in] count - min count of blocks required
+	 * @param[out] blockSize - size of each block in bytes, a multiple of run element size
+	 *
+	 * @return Blocks
+	 */
+	std::vector<char*> SplitIntoBlocks(std::vector<SimpleBlockingMemoryPool::Chunk>& chunks, size_t count,
+		size_t& blockSize)
+	{
+		auto blocksPerChunk = (count + chunks.size() - 1) / chunks.size();
+		auto blockBytes = m_memoryChunkSize / blocksPerChunk;
+		auto alignment = std::lcm<uintmax_t>(m_runElementSize, IO_BLOCK_ALIGNMENT);
+		blockBytes -= blockBytes % (blockBytes >= alignment ? alignment : m_runElementSize);
+
+		if (!blockBytes)
+		{
+			throw SortException("Not enough memory to merge sorted runs");
+		}
+
+		std::vector<char*> blocks;
+		for (auto& chunk : chunks)
+		{
+			for (size_t i = 0; i < blocksPerChunk; i++)
+			{
+				blocks.push_back(chunk.Data() + i * blockBytes);
+			}
+		}
+
+		blockSize = blockBytes;
+		return blocks;
+	}
+
+	/**
+	 * @brief Merge sorted run files
+	 *
+	 * @tparam Reader, Writer - run reader and writer types, @ref RunReader and @ref RunWriter or alike
+	 * @param runs, result, memoryChunkCount - see @ref MergeChunks
+	 * @param less - predicate ordering current elements of two non-empty run readers
+	 * @param write - function writing current element of a run reader to run writer
+	 * @param writeUpTo - function writing current and the following elements of the winner run reader
+	 * not greater than current element of the bound one, at least one. Bound is nullptr if all the other
+	 * runs are exhausted. See @ref WriteUpTo. Not used if the output is limited or of distinct elements
+	 *
+	 * Runs hold distinct elements unless duplicates are kept, so equal elements are at heads of different runs.
+	 * For unique output the first one of them is written, for counted output all of them are, and the writer
+	 * adds their counts up.
+	 */
+	template <typename Reader = RunReader, typename Writer = RunWriter, typename Less, typename Write,
+		typename WriteUpTo>
+	void MergeRunFiles(const std::vector<Run>& runs, const fs::path& result, size_t memoryChunkCount, Less less,
+		Write write, WriteUpTo writeUpTo)
+	{
+		// Double buffering for each of the runs and the result
+		auto chunks = m_memPool->Acquire(memoryChunkCount);
+		size_t blockSize = 0;
+		auto blocks = SplitIntoBlocks(chunks, (runs.size() + 1) * 2, blockSize);
+
+		std::vector<std::unique_ptr<Reader>> readers;
+		for (size_t i = 0; i < runs.size(); i++)
+		{
+			readers.push_back(std::make_unique<Reader>(File::Open(runs[i].fileName, File::Mode::Read, m_ioBackend),
+				blocks[i * 2], blocks[i * 2 + 1], blockSize, m_runElementSize, m_counters));
+		}
+
+		Writer writer(OpenFile(result, File::Mode::Write, m_ioBackend), blocks[runs.size() * 2],
+			blocks[runs.size() * 2 + 1], blockSize, m_runElementSize, m_counters, IndexOf(result));
+
+		auto tree = MakeLoserTree(readers.size(), [&](size_t left, size_t right)
+		{
+			return readers[right]->Empty() || (!readers[left]->Empty() && less(*readers[left], *readers[right]));
+		});
+
+		auto previous = readers.size();
+		uintmax_t written = 0;
+		bool first = true;
+
+		for (auto index = tree.Winner(); !readers[index]->Empty(); index = tree.Winner())
+		{
+			auto winner = readers[index].get();
+
+			// Elements are merged one by one to count the limit of them or to collapse equal ones
+			if (m_limit || m_duplicates != DuplicateMode::Keep)
+			{
+				auto runnerUp = tree.RunnerUp();
+				auto last = m_duplicates == DuplicateMode::Keep || runnerUp == readers.size() ||
+					readers[runnerUp]->Empty() || less(*winner, *readers[runnerUp]);
+
+				if (first || m_duplicates != DuplicateMode::Unique)
+				{
+					write(writer, *winner);
+				}
+
+				winner->Next();
+				first = last;
+
+				if (last && ++written == m_limit)
+				{
+					break;
+				}
+			}
+			// A run winning twice in a row likely holds a range of values below the others,
+			// copy as much of it as the runner-up allows at once
+			else if (index == previous)
+			{
+				auto runnerUp = tree.RunnerUp();
+				auto bound = (runnerUp < readers.size() && !readers[runnerUp]->Empty()) ? readers[runnerUp].get() :
+					nullptr;
+
+				writeUpTo(writer, *winner, bound);
+			}
+			else
+			{
+				write(writer, *winner);
+				winner->Next();
+			}
+
+			previous = index;
+			tree.Update();
+		}
+
+		writer.Close();
+	}
+
+	/**
+	 * @brief Write elements of the winner run reader not greater than the bound one element by element
+	 *
+	 * Generic implementation of the writeUpTo function of @ref MergeRunFiles
+	 */
+	template <typename Writer, typename Reader, typename Less, typename Write>
+	static void WriteUpTo(Writer& writer, Reader& winner, const Reader* bound, Less less, Write write)
+	{
+		do
+		{
+			write(writer, winner);
+			winner.Next();
+		}
+		while (!winner.Empty() && (!bound || !less(*bound, winner)));
+	}
+
+	Run MergeRuns(std::vector<Run>::const_iterator begin, std::vector<Run>::const_iterator end,
+		const fs::path& fileName, size_t memoryChunkCount)
+	{
+		std::vector<Run> runs(begin, end);
+
+		// Runs are created and merged in input order, so merged run covers a contiguous input range too
+		auto offset = runs.front().offset;
+		auto size = runs.back().offset + runs.back().size - offset;
+		auto mergedFileName = fileName.empty() ? CreateChunkFileName(offset, size) : fileName;
+
+		{
+			ScopedTimer timer(m_counters.mergeTime, m_counters.tracer, "merge",
+				{ { "offset", offset }, { "bytes", size }, { "runs", runs.size() } });
+			MergeChunks(runs, mergedFileName, memoryChunkCount);
+		}
+
+		m_counters.mergeCount++;
+
+		// Merged run supersedes its runs in the manifest before they are gone
+		if (fileName.empty())
+		{
+			RecordRun({ offset, size, mergedFileName });
+		}
+
+		std::error_code ec; // Suppress exception on error
+		for (const auto& run : runs)
+		{
+			fs::remove(run.fileName, ec);
+		}
+
+		return { offset, size, mergedFileName };
+	}
+
+	/**
+	 * @brief Sizes of run files
+	 */
+	static std::vector<uintmax_t> RunFileSizes(const std::vector<Run>& runs)
+	{
+		std::vector<uintmax_t> sizes;
+		for (const auto& run : runs)
+		{
+			sizes.push_back(fs::file_size(run.fileName));
+		}
+
+		return sizes;
+	}
+
+	/**
+	 * @brief Groups of runs merged by the next cascade pass
+	 *
+	 * Each group of G runs removes G - 1 of them, until one final merge of at most fan-in F remains.
+	 * Out of R runs, the partial group of the (R - F) mod (F - 1) + 1 smallest adjacent runs is merged first,
+	 * so the rest takes full groups only and each pass merges no more than needed.
+	 *
+	 * @param sizes - sizes of runs in input order, more of them than merge fan-in
+	 *
+	 * @return Ranges of indices of runs in groups, in input order
+	 */
+	std::vector<std::pair<size_t, size_t>> CascadeGroups(const std::vector<uintmax_t>& sizes) const
+	{
+		auto excess = sizes.size() - m_mergeFanIn;
+		auto fullCount = excess / (m_mergeFanIn - 1);
+		auto partialSize = excess % (m_mergeFanIn - 1) + 1;
+		auto partialBegin = sizes.size();
+
+		// A group of a single run would be merged onto itself
+		if (partialSize > 1)
+		{
+			// Merged run must cover a contiguous input range, so the smallest runs are searched by a sliding window
+			auto sum = std::accumulate(sizes.cbegin(), sizes.cbegin() + partialSize, uintmax_t(0));
+			auto minSum = sum;
+			partialBegin = 0;
+
+			for (auto i = partialSize; i < sizes.size(); i++)
+			{
+				sum = sum + sizes[i] - sizes[i - partialSize];
+
+				if (sum < minSum)
+				{
+					minSum = sum;
+					partialBegin = i - partialSize + 1;
+				}
+			}
+		}
+
+		std::vector<std::pair<size_t, size_t>> groups;
+		auto addFullGroups = [&](size_t begin, size_t end)
+		{
+			for (; fullCount > 0 && begin + m_mergeFanIn <= end; begin += m_mergeFanIn, fullCount--)
+			{
+				groups.emplace_back(begin, begin + m_mergeFanIn);
+			}
+		};
+
+		addFullGroups(0, partialBegin);
+
+		if (partialSize > 1)
+		{
+			groups.emplace_back(partialBegin, partialBegin + partialSize);
+			addFullGroups(partialBegin + partialSize, sizes.size());
+		}
+
+		return groups;
+	}
+
+	/**
+	 * @brief Replace groups of items with their merged items, keeping input order
+	 *
+	 * @param items - items in input order
+	 * @param groups - ranges of indices of items in groups, see @ref CascadeGroups
+	 * @param merged - merged items of the groups
+	 */
+	template <typename T>
+	static std::vector<T> ReplaceGroups(const std::vector<T>& items, const std::vector<std::pair<size_t, size_t>>& groups,
+		const std::vector<T>& merged)
+	{
+		std::vector<T> result;
+		size_t next = 0;
+
+		for (size_t i = 0; i < groups.size(); i++)
+		{
+			result.insert(result.end(), items.cbegin() + next, items.cbegin() + groups[i].first);
+			result.push_back(merged[i]);
+			next = groups[i].second;
+		}
+
+		result.insert(result.end(), items.cbegin() + next, items.cend());
+
+		return result;
+	}
+
+	/**
+	 * @brief Estimate count of bytes read by all the merges
+	 *
+	 * Replays @ref CascadeMergeRuns on run file sizes, assuming a merged run takes as much as its runs
+	 */
+	uintmax_t MergeVolume(const std::vector<Run>& runs) const
+	{
+		auto sizes = RunFileSizes(runs);
+		uintmax_t volume = 0;
+
+		while (sizes.size() > m_mergeFanIn)
+		{
+			auto groups = CascadeGroups(sizes);
+			std::vector<uintmax_t> merged;
+
+			for (const auto& group : groups)
+			{
+				merged.push_back(std::accumulate(sizes.cbegin() + group.first, sizes.cbegin() + group.second,
+					uintmax_t(0)));
+				volume += merged.back();
+			}
+
+			sizes = ReplaceGroups(sizes, groups, merged);
+		}
+
+		return volume + std::accumulate(sizes.cbegin(), sizes.cend(), uintmax_t(0));
+	}
+
+	/**
+	 * @brief Reduce run count down to merge fan-in
+	 *
+	 * Merges only as many runs as needed for the final merge to take at most fan-in of them,
+	 * so runs exceeding the fan-in by a little cost merging the few smallest of them, see @ref CascadeGroups.
+	 */
+	std::vector<Run> CascadeMergeRuns(std::vector<Run> runs)
+	{
+		while (runs.size() > m_mergeFanIn)
+		{
+			auto groups = CascadeGroups(RunFileSizes(runs));
+
+			// Share memory between concurrent merges
+			auto memoryChunkCount = std::max<size_t>(m_memPool->Count() / groups.size(), 1);
+
+			std::vector<std::future<Run>> merges;
+			for (const auto& group : groups)
+			{
+				auto begin = runs.cbegin() + group.first;
+				auto end = runs.cbegin() + group.second;
+
+				merges.push_back(m_threadPool.Submit([=]()
+				{	return MergeRuns(begin, end, fs::path(), memoryChunkCount);}));
+			}
+
+			runs = ReplaceGroups(runs, groups, WaitAll(merges));
+		}
+
+		return runs;
+	}
+
+	/**
+	 * @brief Merge sorted slices pairwise
+	 *
+	 * Each pass merges pairs of adjacent slices. Pairs are split into parts of about the same size
+	 * along the merge path, so all the threads are busy even in the last pass merging the only pair.
+	 *
+	 * @param data, scratch - buffers to ping-pong between, data holds sorted slices
+	 * @param slices - offsets of the slices in values, followed by total count of values
+	 *
+	 * @return Pointer to sorted values - either data or scratch
+	 */
+	template <typename T>
+	T* MergeSortedSlices(T* data, T* scratch, std::vector<size_t> slices)
+	{
+		auto count = slices.back();
+		auto partSize = std::max<size_t>(count / m_threadPool.Size(), 1);
+
+		for (; slices.size() > 2; std::swap(data, scratch))
+		{
+			std::vector<std::future<void>> tasks;
+			std::vector<size_t> merged;
+
+			for (size_t i = 0; i + 1 < slices.size(); i += 2)
+			{
+				auto begin = slices[i];
+				auto mid = slices[i + 1];
+				auto end = (i + 2 < slices.size()) ? slices[i + 2] : mid;
+
+				merged.push_back(begin);
+
+				for (auto part = begin; part < end; part += partSize)
+				{
+					auto partEnd = std::min(part + partSize, end);
+
+					tasks.push_back(m_threadPool.Submit([=]()
+					{
+						auto left = data + begin;
+						auto right = data + mid;
+						auto leftSize = mid - begin;
+						auto rightSize = end - mid;
+						auto leftBegin = MergePathSplit(left, leftSize, right, rightSize, part - begin);
+						auto leftEnd = MergePathSplit(left, leftSize, right, rightSize, partEnd - begin);
+						auto rightBegin = part - begin - leftBegin;
+						auto rightEnd = partEnd - begin - leftEnd;
+
+						MergeValues(left + leftBegin, leftEnd - leftBegin, right + rightBegin, rightEnd - rightBegin,
+							scratch + part);
+					}));
+				}
+			}
+
+			merged.push_back(count);
+			WaitAll(tasks);
+			slices = std::move(merged);
+		}
+
+		return data;
+	}
+
+	/**
+	 * @brief Split values into slices for worker threads
+	 *
+	 * @param count - count of values
+	 *
+	 * @return Offsets of the slices, followed by count of values
+	 */
+	std::vector<size_t> SplitIntoSlices(size_t count) const
+	{
+		auto sliceCount = std::max<size_t>(std::min<size_t>(m_threadPool.Size(), count / MIN_SORT_SLICE_SIZE), 1);
+
+		std::vector<size_t> slices;
+		for (size_t i = 0; i < sliceCount; i++)
+		{
+			slices.push_back(count / sliceCount * i);
+		}
+		slices.push_back(count);
+
+		return slices;
+	}
+
+	/**
+	 * @brief Run function for each slice on the worker threads and wait for completion
+	 *
+	 * @param slices - slice offsets as returned by @ref SplitIntoSlices
+	 * @param func - function taking slice index, begin and end offsets
+	 */
+	template <typename F>
+	void ForEachSlice(const std::vector<size_t>& slices, F func)
+	{
+		std::vector<std::future<void>> tasks;
+		for (size_t i = 0; i + 1 < slices.size(); i++)
+		{
+			auto begin = slices[i];
+			auto end = slices[i + 1];
+
+			tasks.push_back(m_threadPool.Submit([=, &func]() { func(i, begin, end); }));
+		}
+
+		WaitAll(tasks);
+	}
+
+	/**
+	 * @brief Parallel LSD radix sort
+	 *
+	 * Each pass counts digits of its slice on every thread, and then every thread
+	 * scatters its slice to the offsets reserved for it in each bucket by the histograms prefix sum.
+	 * Like @ref RadixSort, skips passes where all the values share the same digit.
+	 *
+	 * @param input - values to sort, either data, scratch or a separate buffer
+	 * @param data, scratch - buffers of the input size
+	 * @param count - count of values
+	 *
+	 * @return Pointer to sorted values - either data or scratch
+	 */
+	template <typename T>
+	T* ParallelRadixSort(const T* input, T* data, T* scratch, size_t count)
+	{
+		if (!count)
+		{
+			return data;
+		}
+
+		auto slices = SplitIntoSlices(count);
+		std::vector<std::vector<RadixHistogram>> counts(slices.size() - 1,
+			std::vector<RadixHistogram>(RadixDigitCount<T>()));
+
+		// The first pass gets histograms for all the digits to find out the passes to skip
+		ForEachSlice(slices, [&](size_t slice, size_t begin, size_t end)
+		{
+			for (auto value = input + begin; value != input + end; ++value)
+			{
+				for (auto digit = 0; digit < RadixDigitCount<T>(); digit++)
+				{
+					counts[slice][digit][RadixDigit(*value, digit)]++;
+				}
+			}
+		});
+
+		std::vector<int> digits;
+		for (auto digit = 0; digit < RadixDigitCount<T>(); digit++)
+		{
+			size_t sameDigitCount = 0;
+			for (const auto& sliceCounts : counts)
+			{
+				sameDigitCount += sliceCounts[digit][RadixDigit(input[0], digit)];
+			}
+
+			if (sameDigitCount != count)
+			{
+				digits.push_back(digit);
+			}
+		}
+
+		if (digits.empty())
+		{
+			if (input != data)
+			{
+				ForEachSlice(slices, [&](size_t, size_t begin, size_t end)
+				{	std::copy(input + begin, input + end, data + begin);});
+			}
+
+			return data;
+		}
+
+		auto dest = FirstRadixDestination(input, data, scratch, digits.size());
+		auto other = (dest == data) ? scratch : data;
+		auto sorted = dest;
+
+		for (auto digit : digits)
+		{
+			// Values were moved between slices by the previous pass
+			if (digit != digits.front())
+			{
+				ForEachSlice(slices, [&](size_t slice, size_t begin, size_t end)
+				{
+					auto& histogram = counts[slice][digit];
+					histogram.fill(0);
+
+					for (auto value = input + begin; value != input + end; ++value)
+					{
+						histogram[RadixDigit(*value, digit)]++;
+					}
+				});
+			}
+
+			size_t offset = 0;
+			for (size_t bucket = 0; bucket < RADIX_BUCKET_COUNT; bucket++)
+			{
+				for (auto& sliceCounts : counts)
+				{
+					offset += sliceCounts[digit][bucket];
+					sliceCounts[digit][bucket] = offset - sliceCounts[digit][bucket];
+				}
+			}
+
+			ForEachSlice(slices, [&](size_t slice, size_t begin, size_t end)
+			{
+				auto& offsets = counts[slice][digit];
+
+				for (auto value = input + begin; value != input + end; ++value)
+				{
+					dest[offsets[RadixDigit(*value, digit)]++] = *value;
+				}
+			});
+
+			input = sorted = dest;
+			std::swap(dest, other);
+		}
+
+		return sorted;
+	}
+
+	/**
+	 * @brief Sort values using all the worker threads
+	 *
+	 * Radix kernel runs @ref ParallelRadixSort. Otherwise slices sorted by separate threads
+	 * are merged pairwise.
+	 *
+	 * Must not be called from worker threads, as waits for the tasks it submits.
+	 *
+	 * @param input - values to sort, either data, scratch or a separate buffer
+	 * @param data, scratch - buffers of the input size
+	 * @param count - count of values
+	 *
+	 * @return Pointer to sorted values - either data or scratch
+	 */
+	template <typename T>
+	T* ParallelSort(const T* input, T* data, T* scratch, size_t count)
+	{
+		if (m_sortKernel == SortKernel::Radix)
+		{
+			return ParallelRadixSort(input, data, scratch, count);
+		}
+
+		auto slices = SplitIntoSlices(count);
+
+		ForEachSlice(slices, [&](size_t, size_t begin, size_t end)
+		{
+			auto sorted = SortValues(input + begin, data + begin, scratch + begin, end - begin);
+
+			// Slices are merged from data
+			if (sorted != data + begin)
+			{
+				std::copy(sorted, sorted + (end - begin), data + begin);
+			}
+		});
+
+		return MergeSortedSlices(data, scratch, slices);
+	}
+
+	/**
+	 * @brief Read input file range using all the worker threads
+	 */
+	void ReadInParallel(char* buffer, uintmax_t offset, uintmax_t size)
+	{
+		auto sliceSize = RoundUp<uintmax_t>(std::max<uintmax_t>(size / m_threadPool.Size(), 1), IO_BLOCK_ALIGNMENT);
+
+		std::vector<std::future<void>> tasks;
+		for (uintmax_t slice = 0; slice < size; slice += sliceSize)
+		{
+			tasks.push_back(m_threadPool.Submit([=]()
+			{
+				ReadChunk(buffer + slice, offset + slice, std::min(sliceSize, size - slice));
+			}));
+		}
+
+		WaitAll(tasks);
+	}
+
+	/**
+	 * @brief Report phase completion to the phase callback
+	 *
+	 * @param phase - completed phase
+	 * @param start - phase start time
+	 *
+	 * @return Phase completion time - the next phase start
+	 */
+	std::chrono::steady_clock::time_point CompletePhase(SortPhase phase, std::chrono::steady_clock::time_point start)
+	{
+		auto now = std::chrono::steady_clock::now();
+
+		if (m_phaseCallback)
+		{
+			m_phaseCallback(phase, std::chrono::duration<double>(now - start).count());
+		}
+
+		ReportStats();
+
+		if (phase == SortPhase::RunGeneration)
+		{
+			m_phase = SortPhase::Merge;
+		}
+
+		return now;
+	}
+
+	SortStats Stats()
+	{
+		SortStats stats;
+
+		stats.phase = m_phase;
+		stats.done = m_done;
+		stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+		stats.bytesRead = m_counters.bytesRead;
+		stats.bytesWritten = m_counters.bytesWritten;
+		stats.runCount = m_counters.runCount;
+		stats.mergeCount = m_counters.mergeCount;
+
+		if (stats.phase == SortPhase::RunGeneration)
+		{
+			stats.phaseDone = m_counters.sortedBytes;
+			stats.phaseTotal = m_inStream ? 0 : m_inFileSize;
+		}
+		else
+		{
+			stats.phaseDone = stats.bytesRead - m_mergeReadStart;
+			stats.phaseTotal = m_mergeVolume;
+		}
+
+		stats.readSeconds = Seconds(m_counters.readTime);
+		stats.sortSeconds = Seconds(m_counters.sortTime);
+		stats.writeSeconds = Seconds(m_counters.writeTime);
+		stats.mergeSeconds = Seconds(m_counters.mergeTime);
+
+		if (m_memPool)
+		{
+			stats.poolWaitSeconds = Seconds(m_memPool->WaitTime());
+			stats.poolAvailable = m_memPool->Available();
+		}
+
+		stats.taskQueueDepth = m_threadPool.PendingCount();
+		stats.readQueueDepth = m_counters.readQueueDepth;
+		stats.writeQueueDepth = m_counters.writeQueueDepth;
+
+		return stats;
+	}
+
+	/**
+	 * @brief Report statistics to the statistics callback
+	 */
+	void ReportStats()
+	{
+		if (m_statsCallback)
+		{
+			std::unique_lock<std::mutex> lock(m_statsMutex);
+			m_statsCallback(Stats());
+		}
+	}
+
+	const fs::path m_inFilePath;
+	const fs::path m_outFilePath;
+	SortSource* const m_source;
+	SortSink* const m_sink;
+	const bool m_inStream; ///< Input is streamed from standard input, a connection or a source
+	const bool m_outStream; ///< Output is streamed to standard output, a connection or a sink
+	uintmax_t m_inFileSize; ///< Only known after run generation if input is streamed
+	const size_t m_elementSize;
+	const size_t m_runElementSize; ///< Size of elements of merged runs and output, a value and its count in count mode
+
+	const size_t m_mergeFanIn;
+	const SortKernel m_sortKernel;
+	const bool m_parallelRuns;
+	const IoBackend m_ioBackend;
+	const bool m_hugePages;
+	const std::vector<Numa::Node> m_numaNodes; ///< Nodes workers and memory chunks are split between, empty - no NUMA placement
+
+	const size_t m_sortMemoryChunkCount; ///< Count of memory chunks needed to sort a run
+	const uintmax_t m_memoryBudget;
+	uintmax_t m_memoryChunkSize;
+	size_t m_poolDepth;
+	std::unique_ptr<SimpleBlockingMemoryPool> m_memPool; ///< Only allocated if input doesn't fit in memory at once
+	ThreadPool m_threadPool;
+	std::unique_ptr<MappedFile> m_inMap;
+	ReadFilePool m_inFiles; ///< Input files reused by the threads reading chunks of it
+	const PhaseCallback m_phaseCallback;
+
+	const StatsCallback m_statsCallback;
+	const double m_statsInterval;
+	std::mutex m_statsMutex; ///< Serializes statistics callback calls
+	IoScheduler m_ioScheduler;
+	std::unique_ptr<Tracer> m_tracer; ///< Only created if trace is requested
+	SortCounters m_counters;
+	const std::chrono::steady_clock::time_point m_startTime = std::chrono::steady_clock::now();
+	std::atomic<SortPhase> m_phase { SortPhase::RunGeneration };
+	std::atomic<bool> m_done { false };
+	std::atomic<uintmax_t> m_mergeReadStart { 0 }; ///< Bytes read by run generation
+	std::atomic<uintmax_t> m_mergeVolume { 0 }; ///< Estimated count of bytes read by merges
+
+	const std::vector<fs::path> m_tempRoots; ///< Directories to create temp directories in
+	const TempPlacement m_tempPlacement;
+	std::vector<fs::path> m_tempDirPaths;
+	std::atomic<size_t> m_nextTempDir { 0 };
+
+	const CountingMode m_counting;
+	const bool m_adaptive; ///< Exploit presorted input, see @ref SortOptions::adaptive
+
+	const bool m_resume; ///< Keep runs of a failed sort and reuse the runs of the previous attempt
+	std::vector<Run> m_resumedRuns; ///< Runs left by the previous attempt, ordered by offset
+	std::ofstream m_manifest; ///< Only open for a resumable sort
+	std::mutex m_manifestMutex;
+
+	const uintmax_t m_limit; ///< Max count of elements of each merged run, distinct ones unless duplicates are kept
+	const DuplicateMode m_duplicates;
+
+	const std::unique_ptr<SparseIndexer> m_outputIndex; ///< Index of the output, nullptr - not indexed
+};
+
+/**
+ * @brief Create index of the output if options ask for it, see @ref SortOptions::indexInterval
+ *
+ * @param elementSize - size of sorted values or records in bytes
+ * @param keyOffset - offset of K key in element
+ */
+template <typename K>
+std::unique_ptr<SparseIndexer> CreateOutputIndex(const SortOptions& options, size_t elementSize, size_t keyOffset)
+{
+	if (!options.indexInterval)
+	{
+		return nullptr;
+	}
+
+	// Counted elements are followed by their counts
+	auto countSize = (options.duplicates == DuplicateMode::Count) ? sizeof(uint64_t) : 0;
+
+	return std::make_unique<SparseIndexBuilder<K>>(elementSize + countSize, keyOffset, options.indexInterval);
+}
+
+/**
+ * @brief External sorter of blobs of T values
+ */
+template <typename T>
+class BlobSorter final: public ExternalSorter
+{
+public:
+	BlobSorter(const std::string& inFilePath, const std::string& outFilePath, const SortOptions& options,
+		SortSource* source = nullptr, SortSink* sink = nullptr)
+		: ExternalSorter(inFilePath, outFilePath, options, sizeof(T), SortMemoryChunkCount(options), source, sink,
+			CreateOutputIndex<T>(options, sizeof(T), 0))
+			, m_compressRuns(options.compressRuns && options.duplicates != DuplicateMode::Count)
+			, m_selection(options)
+	{
+	}
+
+private:
+	using Traits = KeyTraits<T>;
+	using Key = typename Traits::Key;
+
+	static T ValueOf(const RunReader& reader)
+	{
+		return reader.Value<T>();
+	}
+
+	static T ValueOf(const CompressedRunReader<T>& reader)
+	{
+		return reader.Value();
+	}
+
+	/**
+	 * @brief Count of memory chunks needed to sort one
+	 *
+	 * Radix sort needs a scratch buffer of the same size
+	 */
+	static size_t SortMemoryChunkCount(const SortOptions& options)
+	{
+		// Parallel std::sort and adaptive sort merge sorted slices into a scratch buffer too
+		return (options.sortKernel == SortKernel::Radix || options.parallelRuns || options.adaptive) ? 2 : 1;
+	}
+
+	char* SortRun(const char* input, std::vector<SimpleBlockingMemoryPool::Chunk>& chunks, uintmax_t& size,
+		bool parallel) override
+	{
+		auto values = reinterpret_cast<const T*>(input);
+		auto data = reinterpret_cast<T*>(chunks[0].Data());
+		auto scratch = (chunks.size() > 1) ? reinterpret_cast<T*>(chunks[1].Data()) : nullptr;
+		auto count = size / sizeof(T);
+
+		// Only the selected values are sorted, equal values need no order
+		if (m_selection.Active())
+		{
+			count = m_selection.Select(values, data, count, [](T value) { return value; });
+			values = data;
+		}
+
+		auto sorted = SortPresorted(values, data, scratch, count, parallel);
+
+		if (!sorted)
+		{
+			sorted = parallel ? ParallelSort(values, data, scratch, count) : SortValues(values, data, scratch, count);
+		}
+
+		count = m_selection.SelectSorted(sorted, count, [](T value) { return value; });
+
+		size = count * sizeof(T);
+		return reinterpret_cast<char*>(sorted);
+	}
+
+	/**
+	 * @brief Sort presorted values in linear time if adaptive sort is on
+	 *
+	 * Values in either order are copied as is or reversed, a few natural runs are merged
+	 *
+	 * @param values, data, scratch, count - see @ref SortValues
+	 * @param parallel - merge natural runs using all the worker threads
+	 *
+	 * @return Pointer to sorted values - either data or scratch, nullptr if values are not presorted
+	 */
+	T* SortPresorted(const T* values, T* data, T* scratch, size_t count, bool parallel)
+	{
+		if (!m_adaptive)
+		{
+			return nullptr;
+		}
+
+		auto runs = FindNaturalRuns(values, count, MAX_NATURAL_RUN_COUNT);
+
+		if (runs.empty())
+		{
+			if (!IsDescending(values, count))
+			{
+				return nullptr;
+			}
+
+			if (values == data)
+			{
+				std::reverse(data, data + count);
+			}
+			else
+			{
+				std::reverse_copy(values, values + count, data);
+			}
+
+			return data;
+		}
+
+		if (values != data)
+		{
+			std::copy(values, values + count, data);
+		}
+
+		return parallel ? MergeSortedSlices(data, scratch, runs) : MergeSlices(data, scratch, runs);
+	}
+
+	/**
+	 * @brief Encode sorted run by @ref RunCodec if run compression is on
+	 *
+	 * Frames are collected in a buffer written in whole direct I/O blocks
+	 */
+	void WriteRun(const char* run, uintmax_t size, const fs::path& fileName) override
+	{
+		if (m_duplicates == DuplicateMode::Count)
+		{
+			WriteCounted(run, size, fileName);
+			return;
+		}
+
+		if (!m_compressRuns)
+		{
+			WriteChunk(run, size, fileName);
+			return;
+		}
+
+		ScopedTimer timer(m_counters.writeTime, m_counters.tracer, "write", { { "bytes", size } });
+		auto file = File::Open(fileName, File::Mode::Write, m_ioBackend);
+		auto buffer = AllocateAligned<char>(RUN_ENCODE_BUFFER_SIZE + RunCodec::MaxFrameSize<Key>());
+		auto values = reinterpret_cast<const T*>(run);
+		auto count = size / sizeof(T);
+		std::array<Key, RunCodec::FRAME_KEY_COUNT> keys;
+		uint64_t offset = 0;
+		size_t filled = 0;
+
+		for (size_t i = 0; i < count; i += keys.size())
+		{
+			auto frameCount = std::min(keys.size(), count - i);
+
+			for (size_t j = 0; j < frameCount; j++)
+			{
+				keys[j] = Traits::ToKey(values[i + j]);
+			}
+
+			filled += RunCodec::EncodeFrame(keys.data(), frameCount, buffer.get() + filled);
+
+			if (filled >= RUN_ENCODE_BUFFER_SIZE)
+			{
+				WriteScheduled(*file, buffer.get(), RUN_ENCODE_BUFFER_SIZE, offset, m_counters);
+				offset += RUN_ENCODE_BUFFER_SIZE;
+				filled -= RUN_ENCODE_BUFFER_SIZE;
+				memcpy(buffer.get(), buffer.get() + RUN_ENCODE_BUFFER_SIZE, filled);
+			}
+		}
+
+		WriteScheduled(*file, buffer.get(), filled, offset, m_counters);
+		m_counters.bytesWritten += offset + filled;
+	}
+
+	void WriteOutput(const char* sorted, uintmax_t size, const fs::path& fileName) override
+	{
+		if (m_duplicates == DuplicateMode::Count)
+		{
+			WriteCounted(sorted, size, fileName);
+		}
+		else
+		{
+			WriteChunk(sorted, size, fileName);
+		}
+	}
+
+	/**
+	 * @brief Write sorted values collapsed into counted values by @ref CountedRunWriter
+	 */
+	void WriteCounted(const char* sorted, uintmax_t size, const fs::path& fileName)
+	{
+		auto buffer = AllocateAligned<char>(SCAN_BLOCK_SIZE * 2);
+		CountedRunWriter<T> writer(OpenFile(fileName, File::Mode::Write, m_ioBackend), buffer.get(),
+			buffer.get() + SCAN_BLOCK_SIZE, SCAN_BLOCK_SIZE, m_runElementSize, m_counters, IndexOf(fileName));
+		auto values = reinterpret_cast<const T*>(sorted);
+
+		for (size_t i = 0; i < size / sizeof(T); i++)
+		{
+			writer.Write(values[i]);
+		}
+
+		writer.Close();
+	}
+
+	/**
+	 * @brief Count of the current counted value of a run reader
+	 */
+	static uint64_t CountOf(const RunReader& reader)
+	{
+		uint64_t count;
+		memcpy(&count, reader.Data() + sizeof(T), sizeof(count));
+
+		return count;
+	}
+
+	void MergeChunks(const std::vector<Run>& runs, const fs::path& result, size_t memoryChunkCount) override
+	{
+		auto less = [](const auto& left, const auto& right) { return Traits::Less(ValueOf(left), ValueOf(right)); };
+		auto write = [](auto& writer, const auto& reader) { writer.Write(ValueOf(reader)); };
+		auto writeUpTo = [=](auto& writer, auto& winner, const auto* bound)
+		{	WriteUpTo(writer, winner, bound, less, write);};
+
+		if (m_duplicates == DuplicateMode::Count)
+		{
+			auto writeCounted = [](CountedRunWriter<T>& writer, const RunReader& reader)
+			{	writer.Write(ValueOf(reader), CountOf(reader));};
+
+			MergeRunFiles<RunReader, CountedRunWriter<T>>(runs, result, memoryChunkCount, less, writeCounted,
+				[=](CountedRunWriter<T>& writer, RunReader& winner, const RunReader* bound)
+				{	WriteUpTo(writer, winner, bound, less, writeCounted);});
+		}
+		else if (!m_compressRuns)
+		{
+			MergeRunFiles(runs, result, memoryChunkCount, less, write,
+				[](RunWriter& writer, RunReader& winner, const RunReader* bound) { CopyUpTo(writer, winner, bound); });
+		}
+		else if (result == m_outFilePath)
+		{
+			MergeRunFiles<CompressedRunReader<T>, RunWriter>(runs, result, memoryChunkCount, less, write, writeUpTo);
+		}
+		else
+		{
+			MergeRunFiles<CompressedRunReader<T>, CompressedRunWriter<T>>(runs, result, memoryChunkCount, less,
+				write, writeUpTo);
+		}
+	}
+
+	/**
+	 * @brief Copy values of the winner run not greater than the bound one
+	 *
+	 * Values are copied from the current block with a single write, found by a vectorized scan for 32-bit values
+	 */
+	static void CopyUpTo(RunWriter& writer, RunReader& winner, const RunReader* bound)
+	{
+		auto count = winner.Available() / sizeof(T);
+
+		if (bound)
+		{
+			count = CountNotGreater(reinterpret_cast<const T*>(winner.Data()), count, bound->Value<T>());
+		}
+
+		writer.Write(winner.Data(), count * sizeof(T));
+		winner.Skip(count * sizeof(T));
+	}
+
+	/**
+	 * @brief Check if the whole input can be sorted in memory at once
+	 *
+	 * Needs input size for a scratch buffer, and as much for data unless the output is mapped
+	 */
+	bool FitsInMemory() const override
+	{
+		return m_inFileSize * (MapsOutput() ? 1 : 2) <= m_memoryBudget;
+	}
+
+	/**
+	 * @brief Sort the whole input in memory
+	 *
+	 * Mapped input is sorted straight into the mapped output file, unless the output is a stream.
+	 * Otherwise the input is read into the scratch buffer, so that the first radix pass
+	 * moves values to data, and sorted values are written with a single write.
+	 */
+	void SortInMemory() override
+	{
+		auto count = m_inFileSize / sizeof(T);
+
+		if (!count)
+		{
+			OpenFile(m_outFilePath, File::Mode::Write, IoBackend::Buffered);
+			return;
+		}
+
+		auto scratch = AllocateAligned<T>(count);
+		AlignedBuffer<T> buffer;
+		std::unique_ptr<MappedFile> outMap;
+		const T* input = scratch.get();
+		T* data = nullptr;
+
+		if (MapsOutput())
+		{
+			outMap = MappedFile::Create(m_outFilePath, m_inFileSize);
+			input = reinterpret_cast<const T*>(m_inMap->Data());
+			data = reinterpret_cast<T*>(outMap->Data());
+		}
+		else
+		{
+			buffer = AllocateAligned<T>(count);
+			data = buffer.get();
+
+			if (m_inMap)
+			{
+				input = reinterpret_cast<const T*>(m_inMap->Data());
+			}
+			else
+			{
+				ReadInParallel(reinterpret_cast<char*>(scratch.get()), 0, m_inFileSize);
+			}
+		}
+
+		T* sorted = nullptr;
+		{
+			ScopedTimer timer(m_counters.sortTime, m_counters.tracer, "sort", { { "bytes", m_inFileSize } });
+
+			if (m_selection.Active())
+			{
+				count = m_selection.Select(input, data, count, [](T value) { return value; });
+				input = data;
+			}
+
+			sorted = SortPresorted(input, data, scratch.get(), count, true);
+
+			if (!sorted)
+			{
+				sorted = ParallelSort(input, data, scratch.get(), count);
+			}
+
+			count = m_selection.SelectSorted(sorted, count, [](T value) { return value; });
+		}
+
+		if (outMap)
+		{
+			if (sorted != data)
+			{
+				memcpy(data, sorted, m_inFileSize);
+			}
+
+			if (m_outputIndex)
+			{
+				m_outputIndex->Add(outMap->Data(), m_inFileSize);
+			}
+		}
+		else
+		{
+			WriteOutput(reinterpret_cast<const char*>(sorted), count * sizeof(T), m_outFilePath);
+		}
+
+		CountRun(m_inFileSize);
+	}
+
+	/**
+	 * @brief Check if the whole input sorted in memory goes straight to the mapped output file
+	 */
+	bool MapsOutput() const
+	{
+		// Selected or collapsed values may not fill the output of input size
+		return m_inMap && !m_outStream && !m_selection.Active() && m_duplicates == DuplicateMode::Keep;
+	}
+
+	std::string RunFormat() const override
+	{
+		const auto& selection = m_selection.Description();
+
+		return "values " + TypeName<T>() + (m_compressRuns ? " compressed" : "") +
+			(selection.empty() ? "" : " " + selection);
+	}
+
+	/**
+	 * @brief Copy input sorted as a whole to the output, reversed if it is in descending order
+	 *
+	 * The input is scanned up to the first value out of both orders, so it costs little
+	 * to find out an input is not sorted, unless it is the end of input only that is not.
+	 */
+	bool CopySortedInput() override
+	{
+		if (m_selection.Active() || m_duplicates != DuplicateMode::Keep)
+		{
+			return false;
+		}
+
+		bool ascending = true;
+		bool descending = true;
+		uintmax_t scanned = 0;
+		T last {};
+
+		ForEachInputBlock([&](const char* block, size_t size)
+		{
+			auto values = reinterpret_cast<const T*>(block);
+			auto count = size / sizeof(T);
+
+			ascending = ascending && (!scanned || !Traits::Less(values[0], last)) &&
+				std::is_sorted(values, values + count, Traits::Less);
+			descending = descending && (!scanned || !Traits::Less(last, values[0])) && IsDescending(values, count);
+			last = values[count - 1];
+			scanned += size;
+
+			return ascending || descending;
+		});
+
+		if (!scanned || !(ascending || descending))
+		{
+			return false;
+		}
+
+		auto buffer = AllocateAligned<char>(SCAN_BLOCK_SIZE * 3);
+		RunWriter writer(OpenFile(m_outFilePath, File::Mode::Write, m_ioBackend), buffer.get(),
+			buffer.get() + SCAN_BLOCK_SIZE, SCAN_BLOCK_SIZE, sizeof(T), m_counters, m_outputIndex.get());
+
+		if (ascending)
+		{
+			ForEachInputBlock([&](const char* block, size_t size)
+			{
+				writer.Write(block, size);
+				m_counters.sortedBytes += size;
+				return true;
+			});
+		}
+		else
+		{
+			// Blocks are read from the end, the first one takes the remainder so the rest are aligned
+			auto block = reinterpret_cast<T*>(buffer.get() + SCAN_BLOCK_SIZE * 2);
+
+			for (auto end = m_inFileSize; end;)
+			{
+				auto size = (end % SCAN_BLOCK_SIZE) ? end % SCAN_BLOCK_SIZE : SCAN_BLOCK_SIZE;
+				end -= size;
+
+				if (m_inMap)
+				{
+					memcpy(block, m_inMap->Data() + end, size);
+				}
+				else
+				{
+					ReadChunk(reinterpret_cast<char*>(block), end, size);
+				}
+
+				std::reverse(block, block + size / sizeof(T));
+				writer.Write(reinterpret_cast<const char*>(block), size);
+				m_counters.sortedBytes += size;
+			}
+		}
+
+		writer.Close();
+		return true;
+	}
+
+	/**
+	 * @brief Counting table window and hash table capacity of @ref KeyHistogram
+	 */
+	struct CountingPlan
+	{
+		Key low;
+		size_t windowSize;
+		size_t hashCapacity;
+	};
+
+	/**
+	 * @brief Plan counting sort within the memory budget
+	 *
+	 * The whole key space gets a counting table if it is small, e.g. of 16-bit values. Otherwise the plan
+	 * is based on a sample of the input: the table covers the sampled key range but the outliers,
+	 * widened by a margin, if it is small, and the hash table takes the rest of the budget. A table is small
+	 * as long as scanning it for the output costs no more than the input.
+	 *
+	 * @return false if the input is not worth counting
+	 */
+	bool PlanCounting(CountingPlan& plan)
+	{
+		constexpr auto keyBits = sizeof(Key) * 8;
+		constexpr uintmax_t maxKey = std::numeric_limits<Key>::max();
+		auto count = m_inFileSize / sizeof(T);
+		auto maxWindow = std::min<uintmax_t>(m_memoryBudget / sizeof(uint64_t),
+			std::max<uintmax_t>(count, MIN_COUNTING_WINDOW));
+
+		if (!count)
+		{
+			return false;
+		}
+
+		if (keyBits < 64 && maxKey < maxWindow)
+		{
+			plan = { 0, static_cast<size_t>(maxKey + 1), 0 };
+			return true;
+		}
+
+		auto sample = SampleKeys();
+		std::sort(sample.begin(), sample.end());
+
+		// Rare outliers are left to the hash table
+		auto trim = sample.size() / COUNTING_SAMPLE_TRIM;
+		uintmax_t first = sample[trim];
+		uintmax_t last = sample[sample.size() - 1 - trim];
+		auto distinct = std::unique(sample.begin(), sample.end()) - sample.begin();
+		auto margin = (last - first) / 8;
+		auto low = first - std::min(margin, first);
+		auto high = last + std::min(margin, maxKey - last);
+
+		auto dense = high - low < maxWindow;
+		auto repeated = distinct * COUNTING_MIN_REPEAT <= sample.size();
+
+		if (!dense && !repeated && m_counting == CountingMode::Auto)
+		{
+			return false;
+		}
+
+		plan.low = dense ? low : 0;
+		plan.windowSize = dense ? high - low + 1 : 0;
+
+		// Hash table takes the rest of the budget, but no more than it takes to fit all the values
+		// within its fill limit of a half
+		auto maxCapacity = (m_memoryBudget - plan.windowSize * sizeof(uint64_t)) /
+			sizeof(typename KeyHistogram<Key>::Entry);
+		uintmax_t capacity = 1;
+
+		while (capacity < count * 2 && capacity * 2 <= maxCapacity)
+		{
+			capacity *= 2;
+		}
+
+		plan.hashCapacity = (capacity <= maxCapacity) ? capacity : 0;
+
+		return true;
+	}
+
+	/**
+	 * @brief Read keys of blocks spread evenly over the input, or of the whole input if it is small
+	 */
+	std::vector<Key> SampleKeys()
+	{
+		auto count = m_inFileSize / sizeof(T);
+		auto blockCount = (count > COUNTING_SAMPLE_BLOCK_COUNT * COUNTING_SAMPLE_BLOCK_SIZE) ?
+			COUNTING_SAMPLE_BLOCK_COUNT : 1;
+		auto blockSize = (blockCount > 1) ? COUNTING_SAMPLE_BLOCK_SIZE : count;
+		std::vector<T> values(blockCount * blockSize);
+		std::unique_ptr<File> file;
+
+		// Sample blocks are small and not aligned, so they are read through page cache
+		if (!m_inMap)
+		{
+			file = File::Open(m_inFilePath, File::Mode::Read, IoBackend::Buffered);
+		}
+
+		for (size_t i = 0; i < blockCount; i++)
+		{
+			auto offset = (blockCount > 1) ? i * (count - blockSize) / (blockCount - 1) * sizeof(T) : 0;
+			auto block = reinterpret_cast<char*>(values.data() + i * blockSize);
+			auto size = blockSize * sizeof(T);
+
+			if (m_inMap)
+			{
+				memcpy(block, m_inMap->Data() + offset, size);
+			}
+			else if (file->Read(block, size, offset) != size)
+			{
+				throw SortException("Failed to read input sample");
+			}
+
+			m_counters.bytesRead += size;
+		}
+
+		std::vector<Key> keys;
+		keys.reserve(values.size());
+
+		for (auto value : values)
+		{
+			keys.push_back(Traits::ToKey(value));
+		}
+
+		return keys;
+	}
+
+	/**
+	 * @brief Sort values by counting them, see @ref CountingMode
+	 *
+	 * Input is read once, and the output is written from the counts.
+	 * Nothing is written if there are too many distinct values to count.
+	 */
+	bool SortByCounting() override
+	{
+		CountingPlan plan;
+
+		if (!PlanCounting(plan))
+		{
+			return false;
+		}
 
-constexpr auto MAX_ALLOCATED_MEMORY_SIZE = 256LL << 20; ///< 256Mb - Max allowed memory allocation size
-constexpr auto FILE_SIZE_MULTIPLIER = 4; ///<  4byte - File size must be a multiple of this
+		KeyHistogram<Key> histogram(plan.low, plan.windowSize, plan.hashCapacity);
+		{
+			ScopedTimer timer(m_counters.sortTime, m_counters.tracer, "sort", { { "bytes", m_inFileSize } });
 
-/**
- * Round up function (as suggested by Tigran Avanesov)
- */
-template <typename T>
-T RoundUp(T num, T factor)
-{
-    return num + factor - 1 - (num - 1) % factor;
-}
+			if (!CountValues(histogram))
+			{
+				// The regular sort starts over
+				m_counters.sortedBytes = 0;
+				return false;
+			}
+		}
 
-/**
- * @brief uint32_t wrapper class
- *
- * Wrapper class to enable uint32_t streamed input/output.
- * Also provides 'operator<' for sorting it's values.
- */
-class Uint32Value
-{
-	friend std::istream& operator>>(std::istream&, Uint32Value&);
-	friend std::ostream& operator<<(std::ostream&, const Uint32Value&);
+		auto buffer = AllocateAligned<char>(SCAN_BLOCK_SIZE * 2);
 
-public:
-	bool operator<(const Uint32Value& other) const
+		// Counts are of the selected values only, the smallest ones are written up to the limit
+		auto remaining = m_selection.Limit() ? m_selection.Limit() : std::numeric_limits<uintmax_t>::max();
+
+		if (m_duplicates == DuplicateMode::Count)
 		{
-		return m_value < other.m_value;
-	}
+			CountedRunWriter<T> writer(OpenFile(m_outFilePath, File::Mode::Write, m_ioBackend), buffer.get(),
+				buffer.get() + SCAN_BLOCK_SIZE, SCAN_BLOCK_SIZE, m_runElementSize, m_counters, m_outputIndex.get());
 
-private:
-	uint32_t m_value = 0;
-};
+			histogram.ForEach([&](Key key, uint64_t count)
+			{
+				if (remaining)
+				{
+					writer.Write(Traits::FromKey(key), count);
+					remaining--;
+				}
+			});
 
-std::istream& operator>>(std::istream& strm, Uint32Value& value)
-{
-	return strm.read(reinterpret_cast<char*>(&value.m_value), sizeof(value.m_value));
-}
+			writer.Close();
+			return true;
+		}
 
-std::ostream& operator<<(std::ostream& strm, const Uint32Value& value)
-{
-	return strm.write(reinterpret_cast<const char*>(&value.m_value), sizeof(value.m_value));
-}
+		RunWriter writer(OpenFile(m_outFilePath, File::Mode::Write, m_ioBackend), buffer.get(),
+			buffer.get() + SCAN_BLOCK_SIZE, SCAN_BLOCK_SIZE, sizeof(T), m_counters, m_outputIndex.get());
 
-/**
- * @brief Simple blocking memory pool
- */
-class SimpleBlockingMemoryPool
-{
-	friend class Chunk;
+		histogram.ForEach([&](Key key, uint64_t count)
+		{
+			auto value = Traits::FromKey(key);
+
+			// Unique value is written once
+			for (uint64_t i = 0; i < (m_duplicates == DuplicateMode::Unique ? 1 : count) && remaining; i++, remaining--)
+			{
+				writer.Write(value);
+			}
+		});
+
+		writer.Close();
+		return true;
+	}
 
-public:
 	/**
-	 * @brief Memory chunk
+	 * @brief Count values of the input
 	 *
-	 * A RAII helper class to automatically release acquired chunk
+	 * @return false if there are too many distinct values to count
 	 */
-	class Chunk
+	bool CountValues(KeyHistogram<Key>& histogram)
 	{
-		friend class SimpleBlockingMemoryPool;
+		return ForEachInputBlock([&](const char* block, size_t size)
+		{
+			auto values = reinterpret_cast<const T*>(block);
 
-	public:
-		Chunk(const Chunk&) = delete;
-		Chunk& operator=(const Chunk&) = delete;
+			for (size_t i = 0; i < size / sizeof(T); i++)
+			{
+				if (m_selection.Selected(values[i]) && !histogram.Add(Traits::ToKey(values[i])))
+				{
+					return false;
+				}
+			}
 
-		Chunk(Chunk&& other)
-			:
-				m_pool(other.m_pool)
-		{
-			std::swap(m_buff, other.m_buff);
-		}
+			m_counters.sortedBytes += size;
+			return true;
+		});
+	}
 
-		operator char*()
+	const bool m_compressRuns;
+	ValueSelection<T> m_selection; ///< Values of the output, see @ref SortOptions::limit and @ref SortOptions::rangeLow
+};
+
+/**
+ * @brief External sorter of fixed-size records by K key
+ *
+ * Each run is sorted as an array of (key, index) pairs, and then records are gathered
+ * in the sorted order, so wide records are moved once instead of on each radix pass or comparison.
+ */
+template <typename K>
+class RecordSorter final: public ExternalSorter
+{
+public:
+	RecordSorter(const std::string& inFilePath, const std::string& outFilePath, const SortOptions& options,
+		SortSource* source = nullptr, SortSink* sink = nullptr)
+		: ExternalSorter(inFilePath, outFilePath, options, options.recordSize,
+			2 + PairChunkCount(options.recordSize), source, sink,
+			CreateOutputIndex<K>(options, options.recordSize, options.keyOffset))
+			, m_keyOffset(options.keyOffset)
+			, m_selection(options)
+	{
+		if (m_keyOffset + sizeof(K) > m_elementSize)
 		{
-			return m_buff;
+			throw SortException("Key doesn't fit in the record");
 		}
 
-		char* Data()
+		if (options.duplicates == DuplicateMode::Count)
 		{
-			return m_buff;
+			throw SortException("Only values can be counted");
 		}
 
-		~Chunk() noexcept
+		if (sizeof(Pair) > m_elementSize)
 		{
-			m_pool.Release(m_buff);
+			throw SortException("Record is too small to be sorted by key");
 		}
 
-	private:
-		explicit Chunk(SimpleBlockingMemoryPool& pool)
-			: m_pool(pool)
+		if (m_memoryChunkSize / m_elementSize > std::numeric_limits<uint32_t>::max())
 		{
+			throw SortException("Memory chunk holds too many records");
 		}
+	}
 
-		SimpleBlockingMemoryPool& m_pool;
-		char* m_buff = nullptr;
-	};
-
-	SimpleBlockingMemoryPool(const SimpleBlockingMemoryPool&) = delete;
-	SimpleBlockingMemoryPool operator=(const SimpleBlockingMemoryPool&) = delete;
+private:
+	using Pair = KeyIndex<K>;
+	using Traits = KeyTraits<K>;
 
 	/**
-	 * @biref Constructor
-	 *
-	 * Construct pool given object size and count
+	 * @brief Count of memory chunks taken by pairs and their scratch buffer
 	 *
-	 * @param size - size of object in bytes
-	 * @param count - count of objects in pool.
+	 * Both fit in a single chunk if a pair is at most a half of the record
 	 */
-	SimpleBlockingMemoryPool(int size, int count)
-		: m_buff(size * count)
+	static size_t PairChunkCount(size_t recordSize)
 	{
-		for (int i = 0; i < count; i++)
-		{
-			m_queue.push(&m_buff[i * size]);
-		}
+		return (2 * sizeof(Pair) <= recordSize) ? 1 : 2;
+	}
+
+	K Key(const char* record) const
+	{
+		K key;
+		memcpy(&key, record + m_keyOffset, sizeof(key));
+
+		return key;
 	}
 
 	/**
-	 * @brief Acquire chunk of memory
-	 *
-	 * Blocks if pool is empty
+	 * @brief Sort records
 	 *
-	 * @return A chunk of memory
+	 * The first chunk holds input records, the second one receives sorted records,
+	 * the rest hold pairs and their scratch buffer
 	 */
-	Chunk Acquire()
+	char* SortRun(const char* input, std::vector<SimpleBlockingMemoryPool::Chunk>& chunks, uintmax_t& size,
+		bool parallel) override
 	{
-		auto chunk = Chunk(*this);
+		auto count = size / m_elementSize;
+		auto output = chunks[1].Data();
+		auto pairs = reinterpret_cast<Pair*>(chunks[2].Data());
+		auto scratch = (chunks.size() > 3) ? reinterpret_cast<Pair*>(chunks[3].Data()) : pairs + count;
 
-		std::unique_lock<std::mutex> lock(m_mutex);
+		auto forEachSlice = [&](auto func)
+		{
+			if (parallel)
+			{
+				ForEachSlice(SplitIntoSlices(count), func);
+			}
+			else
+			{
+				func(0, 0, count);
+			}
+		};
 
-		m_queueCond.wait(lock, [=](){ return !m_queue.empty(); });
+		forEachSlice([&](size_t, size_t begin, size_t end)
+		{
+			for (auto i = begin; i < end; i++)
+			{
+				pairs[i] = { Key(input + i * m_elementSize), static_cast<uint32_t>(i) };
+			}
+		});
 
-		chunk.m_buff = m_queue.front();
-		m_queue.pop();
+		// Records of equal keys are kept in input order
+		if (m_selection.Active())
+		{
+			count = m_selection.Select(pairs, pairs, count, [](const Pair& pair) { return pair.key; }, scratch);
+		}
 
-		return chunk;
+		auto sorted = parallel ? ParallelSort(pairs, pairs, scratch, count) : SortValues(pairs, pairs, scratch, count);
+		count = m_selection.SelectSorted(sorted, count, [](const Pair& pair) { return pair.key; });
+
+		forEachSlice([&](size_t, size_t begin, size_t end)
+		{
+			for (auto i = begin; i < end; i++)
+			{
+				memcpy(output + i * m_elementSize, input + sorted[i].index * m_elementSize, m_elementSize);
+			}
+		});
+
+		size = count * m_elementSize;
+		return output;
 	}
 
-private:
-	void Release(char* chunk)
+	void MergeChunks(const std::vector<Run>& runs, const fs::path& result, size_t memoryChunkCount) override
 	{
-		{
-			std::unique_lock<std::mutex> lock(m_mutex);
-			m_queue.push(chunk);
-		}
+		auto less = [this](const RunReader& left, const RunReader& right)
+		{	return Traits::Less(Key(left.Data()), Key(right.Data()));};
+		auto write = [](RunWriter& writer, const RunReader& reader) { writer.Write(reader.Data()); };
 
-		m_queueCond.notify_one();
+		MergeRunFiles(runs, result, memoryChunkCount, less, write,
+			[=](RunWriter& writer, RunReader& winner, const RunReader* bound)
+			{	WriteUpTo(writer, winner, bound, less, write);});
 	}
 
-	std::mutex m_mutex;
-	std::vector<char> m_buff;
-	std::condition_variable m_queueCond;
-	std::queue<char*> m_queue;
+	std::string RunFormat() const override
+	{
+		const auto& selection = m_selection.Description();
+
+		return "records " + TypeName<K>() + " key at " + std::to_string(m_keyOffset) +
+			(selection.empty() ? "" : " " + selection);
+	}
+
+	const size_t m_keyOffset;
+	ValueSelection<K> m_selection; ///< Records of the output by keys, see @ref SortOptions::limit
 };
 
 /**
- * @brief Create temp directory
- *
- * Creates temp directory with unique name
- *
- * @param[in] pathTemplate - directory name template prefix. Must be in form "<prefix>_XXXXXX"
+ * @brief Range partitioner of values or records by K keys, see @ref PartitionBlobT
  *
- * @return Unique temp directory path
+ * Splitters are picked from a sample of the input, then the input is read once and each element
+ * goes to the output of its range. Outputs are written by double-buffered writers, so that
+ * all of them, e.g. connections to different hosts, are written at the same time.
  */
-fs::path CreateUniqueTempDirectory(const std::string& pathTemplate)
+template <typename K>
+class Partitioner
 {
-	// Need to make a copy as mkdtemp returns a pointer to the modified template string
-	std::vector<char> buff(pathTemplate.size() + 1);
+public:
+	Partitioner(const std::string& inFilePath, const std::vector<std::string>& outFilePaths,
+		const SortOptions& options)
+		: m_inFilePath(inFilePath)
+			, m_outFilePaths(outFilePaths)
+			, m_elementSize(options.recordSize ? options.recordSize : sizeof(K))
+			, m_keyOffset(options.recordSize ? options.keyOffset : 0)
+			, m_ioBackend(options.ioBackend)
+			, m_ioScheduler(options.deviceStreams, options.bandwidthLimits)
+	{
+		if (IsStream(inFilePath))
+		{
+			throw SortException("Streamed input can't be partitioned");
+		}
 
-	strncpy(buff.data(), pathTemplate.data(), buff.size());
+		if (m_outFilePaths.empty())
+		{
+			throw SortException("No partition outputs");
+		}
 
-	if (!mkdtemp(buff.data()))
-	{
-		throw SortException("Failed to create temp directory");
-	}
+		if (m_keyOffset + sizeof(K) > m_elementSize)
+		{
+			throw SortException("Key doesn't fit in the record");
+		}
 
-	return buff.data();
-}
+		m_inFileSize = fs::file_size(inFilePath);
 
-struct Blob32Sorter
-{
-	Blob32Sorter(const std::string& inFilePath, const std::string& outFilePath)
-		: m_inFilePath(inFilePath)
-			, m_outFilePath(outFilePath)
-			, m_inFileSize(fs::file_size(inFilePath))
-			, m_tempDirPath(CreateUniqueTempDirectory(fs::temp_directory_path() / "blobsort_XXXXXX"))
-			, m_memoryChunkSize(CalcMemoryChunkSize())
-			, m_memPool(m_memoryChunkSize, MAX_ALLOCATED_MEMORY_SIZE / m_memoryChunkSize)
-	{
-		if (m_inFileSize % FILE_SIZE_MULTIPLIER)
+		if (m_inFileSize % m_elementSize)
 		{
-			throw SortException("File size is not a multiple of 4Gb");
+			throw SortException("File size is not a multiple of the element size");
 		}
+
+		auto alignment = std::lcm<uintmax_t>(m_elementSize, IO_BLOCK_ALIGNMENT);
+		m_blockSize = std::max<uintmax_t>(SCAN_BLOCK_SIZE / alignment, 1) * alignment;
+		m_counters.ioScheduler = &m_ioScheduler;
 	}
 
-	~Blob32Sorter() noexcept
+	void Partition()
 	{
-		std::error_code ec;
-		if (fs::exists(m_tempDirPath, ec))
+		auto splitters = Splitters();
+
+		std::vector<AlignedBuffer<char>> buffers;
+		std::vector<std::unique_ptr<RunWriter>> writers;
+
+		for (const auto& path : m_outFilePaths)
 		{
-			fs::remove_all(m_tempDirPath, ec);
+			buffers.push_back(AllocateAligned<char>(m_blockSize * 2));
+			writers.push_back(std::make_unique<RunWriter>(File::Open(path, File::Mode::Write, m_ioBackend),
+				buffers.back().get(), buffers.back().get() + m_blockSize, m_blockSize, m_elementSize, m_counters));
 		}
-	}
 
-	static int CalcMemoryChunkSize()
-	{
-		// Two chunks per CPU core
-		return MAX_ALLOCATED_MEMORY_SIZE / (std::thread::hardware_concurrency() * 2);
-	}
+		auto buffer = AllocateAligned<char>(m_blockSize * 2);
+		RunReader reader(File::Open(m_inFilePath, File::Mode::Read, m_ioBackend), buffer.get(),
+			buffer.get() + m_blockSize, m_blockSize, m_elementSize, m_counters);
 
-	void ReadChunk(char* chunk, uintmax_t offset, uintmax_t size)
-	{
-		std::ifstream strm(m_inFilePath, std::ios::binary);
+		// Elements equal to a splitter go to the range above it
+		for (; !reader.Empty(); reader.Next())
+		{
+			auto key = Traits::ToKey(KeyOf(reader.Data()));
+			auto range = std::upper_bound(splitters.cbegin(), splitters.cend(), key) - splitters.cbegin();
+
+			writers[range]->Write(reader.Data());
+		}
 
-		if (!strm.seekg(offset, std::ios::beg).read(chunk, size))
+		for (auto& writer : writers)
 		{
-			throw SortException("Failed to read input chunk");
+			writer->Close();
 		}
 	}
 
-	auto CreateChunkFileName(uintmax_t offset, uintmax_t size)
-	{
-		std::stringstream strm;
+private:
+	using Traits = KeyTraits<K>;
+	using Key = typename Traits::Key;
 
-		strm << std::hex << std::setfill('0')
-			<< std::setw(8) << offset << ':'
-			<< std::setw(8) << size;
+	K KeyOf(const char* element) const
+	{
+		K key;
+		memcpy(&key, element + m_keyOffset, sizeof(key));
 
-		return m_tempDirPath / strm.str();
+		return key;
 	}
 
-	auto CreateSortedChunk(uintmax_t offset, uintmax_t size, const fs::path& fileName)
+	/**
+	 * @brief Pick splitters - quantiles of keys of blocks spread evenly over the input
+	 *
+	 * @return Ascending keys, one less than outputs, or none if the input is empty
+	 */
+	std::vector<Key> Splitters()
 	{
-		auto chunk = m_memPool.Acquire();
-		ReadChunk(chunk, offset, size);
+		auto count = m_inFileSize / m_elementSize;
+		auto blockCount = (count > PARTITION_SAMPLE_BLOCK_COUNT * PARTITION_SAMPLE_BLOCK_SIZE) ?
+			PARTITION_SAMPLE_BLOCK_COUNT : 1;
+		auto blockSize = (blockCount > 1) ? PARTITION_SAMPLE_BLOCK_SIZE : count;
+		std::vector<char> block(blockSize * m_elementSize);
+		std::vector<Key> keys;
 
-		auto begin = reinterpret_cast<uint32_t*>(chunk.Data());
-		auto end = reinterpret_cast<uint32_t*>(chunk + size);
+		// Sample blocks are small and not aligned, so they are read through page cache
+		auto file = File::Open(m_inFilePath, File::Mode::Read, IoBackend::Buffered);
 
-		std::sort(begin, end);
+		for (size_t i = 0; i < blockCount && count; i++)
+		{
+			auto offset = (blockCount > 1) ? i * (count - blockSize) / (blockCount - 1) * m_elementSize : 0;
+
+			if (file->Read(block.data(), block.size(), offset) != block.size())
+			{
+				throw SortException("Failed to read input sample");
+			}
 
-		auto chunkFileName = fileName.empty() ? CreateChunkFileName(offset, size) :
-			fileName;
+			for (size_t j = 0; j < blockSize; j++)
+			{
+				keys.push_back(Traits::ToKey(KeyOf(block.data() + j * m_elementSize)));
+			}
+		}
 
-		std::ofstream strm(chunkFileName, std::ios::binary);
+		std::sort(keys.begin(), keys.end());
 
-		if (!strm.write(chunk, size))
+		std::vector<Key> splitters;
+		for (size_t i = 1; i < m_outFilePaths.size() && !keys.empty(); i++)
 		{
-			throw SortException("Failed to open file to write sorted chunk");
+			splitters.push_back(keys[i * keys.size() / m_outFilePaths.size()]);
 		}
 
-		return chunkFileName;
+		return splitters;
 	}
 
-	void MergeChunks(const fs::path& left, const fs::path& right, const fs::path& result)
-	{
-		// Use printf here instead of std::cout to avoid interleaving messages from different threads
-		printf("Merging %s and %s into %s\n", left.c_str(), right.c_str(), result.c_str());
+	const fs::path m_inFilePath;
+	const std::vector<std::string> m_outFilePaths;
+	const size_t m_elementSize;
+	const size_t m_keyOffset;
+	const IoBackend m_ioBackend;
+	IoScheduler m_ioScheduler;
+	uintmax_t m_inFileSize = 0;
+	size_t m_blockSize = 0; ///< Size of input and output blocks, a multiple of element size
+	SortCounters m_counters;
+};
 
-		std::ifstream leftStrm(left, std::ios::binary);
-		std::ifstream rightStrm(right, std::ios::binary);
-		std::ofstream resultStrm(result, std::ios::binary);
-		std::istream_iterator<Uint32Value> eos;
+/**
+ * @brief Source of values in memory
+ */
+class SpanSource: public SortSource
+{
+public:
+	SpanSource(const void* data, size_t size)
+		: m_data(static_cast<const char*>(data))
+			, m_size(size)
+	{
+	}
 
-		std::merge(std::istream_iterator<Uint32Value>(leftStrm), eos,
-			std::istream_iterator<Uint32Value>(rightStrm), eos,
-			std::ostream_iterator<Uint32Value>(resultStrm));
+	size_t Read(void* buffer, size_t size) override
+	{
+		size = std::min(size, m_size);
+		memcpy(buffer, m_data, size);
+		m_data += size;
+		m_size -= size;
 
-		if (leftStrm.bad() || rightStrm.bad() || resultStrm.bad())
-		{
-			throw SortException("I/O error during chunks merge");
-		}
+		return size;
 	}
 
-	fs::path MapReduceChunks(uintmax_t offset, uintmax_t size, const fs::path& fileName)
+private:
+	const char* m_data;
+	size_t m_size;
+};
+
+/**
+ * @brief Sink passing blocks of values to callback
+ */
+template <typename T>
+class CallbackSink: public SortSink
+{
+public:
+	explicit CallbackSink(const SortedCallback<T>& output)
+		: m_output(output)
 	{
-		auto leftSize = RoundUp(size / 2, sizeof(uint32_t));
-		auto rightSize = size - leftSize;
-		auto leftOffset = offset;
-		auto rightOffset = offset + leftSize;
+	}
 
-		auto leftBranch = std::async(std::launch::async, [=]()
-		{	return MapReduceOrCreateSortedChunks(leftOffset, leftSize);});
-		auto rightBranch = std::async(std::launch::async, [=]()
-		{	return MapReduceOrCreateSortedChunks(rightOffset, rightSize);});
+	void Write(const void* data, size_t size) override
+	{
+		// Output blocks are of whole values, aligned as the memory pool and I/O buffers are
+		if (size % sizeof(T))
+		{
+			throw SortException("Output block is not of whole values");
+		}
 
-		leftBranch.wait();
-		rightBranch.wait();
+		if (!size)
+		{
+			return;
+		}
 
-		auto leftChunkFileName = leftBranch.get();
-		auto rightChunkFileName = rightBranch.get();
-		auto mergedFileName = fileName.empty() ? CreateChunkFileName(offset, size) : fileName;
+		m_output(static_cast<const T*>(data), size / sizeof(T));
+	}
 
-		MergeChunks(leftChunkFileName, rightChunkFileName, mergedFileName);
+private:
+	const SortedCallback<T>& m_output;
+};
 
-		std::error_code ec; // Suppress exception on error
-		fs::remove(leftChunkFileName, ec);
-		fs::remove(rightChunkFileName, ec);
+/**
+ * @brief Check if options are of fixed-size records rather than of T values themselves
+ */
+template <typename T>
+bool SortsRecords(const SortOptions& options)
+{
+	return options.recordSize && (options.recordSize != sizeof(T) || options.keyOffset);
+}
 
-		return mergedFileName;
+/**
+ * @brief Sort by the sorter of options
+ *
+ * @param inFilePath, outFilePath, options, source, sink - see @ref ExternalSorter::ExternalSorter
+ */
+template <typename T>
+void SortWithSorter(const std::string& inFilePath, const std::string& outFilePath, const SortOptions& options,
+	SortSource* source, SortSink* sink)
+{
+	if (SortsRecords<T>(options))
+	{
+		RecordSorter<T>(inFilePath, outFilePath, options, source, sink).Sort();
 	}
-
-	fs::path MapReduceOrCreateSortedChunks(uintmax_t offset, uintmax_t size, const fs::path& fileName = fs::path())
+	else
 	{
-		return (size > m_memoryChunkSize) ? MapReduceChunks(offset, size, fileName) :
-			CreateSortedChunk(offset, size, fileName);
+		BlobSorter<T>(inFilePath, outFilePath, options, source, sink).Sort();
 	}
+}
 
-	void Sort()
+}
+
+template <typename T>
+void SortBlobT(const std::string& inFilePath, const std::string& outFilePath, const SortOptions& options)
+{
+	try
+	{
+		SortWithSorter<T>(inFilePath, outFilePath, options, nullptr, nullptr);
+	}
+	catch (const std::system_error& e)
 	{
-		MapReduceOrCreateSortedChunks(0, m_inFileSize, m_outFilePath);
+		throw SortException(e.what());
 	}
+}
 
-	const fs::path m_inFilePath;
-	const fs::path m_outFilePath;
-	const uintmax_t m_inFileSize;
+template <typename T>
+void SortBlobT(SortSource& source, SortSink& sink, const SortOptions& options)
+{
+	try
+	{
+		SortWithSorter<T>(SOURCE_NAME, SINK_NAME, options, &source, &sink);
+	}
+	catch (const std::system_error& e)
+	{
+		throw SortException(e.what());
+	}
+}
 
-	fs::path m_tempDirPath;
+template <typename T>
+void SortBlobT(const T* values, size_t count, const SortedCallback<T>& output, const SortOptions& options)
+{
+	if (SortsRecords<T>(options) || options.duplicates == DuplicateMode::Count)
+	{
+		throw SortException("Only values can be passed to a callback");
+	}
 
-	uintmax_t m_memoryChunkSize;
-	SimpleBlockingMemoryPool m_memPool;
-};
+	SpanSource source(values, count * sizeof(T));
+	CallbackSink<T> sink(output);
 
+	SortBlobT<T>(source, sink, options);
 }
 
-void SortBlob32(const std::string& inFilePath, const std::string& outFilePath)
+template <typename T>
+void PartitionBlobT(const std::string& inFilePath, const std::vector<std::string>& outFilePaths,
+	const SortOptions& options)
 {
 	try
 	{
-		Blob32Sorter(inFilePath, outFilePath).Sort();
+		Partitioner<T>(inFilePath, outFilePaths, options).Partition();
 	}
 	catch (const std::system_error& e)
 	{
@@ -365,4 +5258,50 @@ void SortBlob32(const std::string& inFilePath, const std::string& outFilePath)
 	}
 }
 
+template void SortBlobT<uint16_t>(const std::string&, const std::string&, const SortOptions&);
+template void SortBlobT<uint32_t>(const std::string&, const std::string&, const SortOptions&);
+template void SortBlobT<uint64_t>(const std::string&, const std::string&, const SortOptions&);
+template void SortBlobT<int16_t>(const std::string&, const std::string&, const SortOptions&);
+template void SortBlobT<int32_t>(const std::string&, const std::string&, const SortOptions&);
+template void SortBlobT<int64_t>(const std::string&, const std::string&, const SortOptions&);
+template void SortBlobT<float>(const std::string&, const std::string&, const SortOptions&);
+template void SortBlobT<double>(const std::string&, const std::string&, const SortOptions&);
+
+template void SortBlobT<uint16_t>(SortSource&, SortSink&, const SortOptions&);
+template void SortBlobT<uint32_t>(SortSource&, SortSink&, const SortOptions&);
+template void SortBlobT<uint64_t>(SortSource&, SortSink&, const SortOptions&);
+template void SortBlobT<int16_t>(SortSource&, SortSink&, const SortOptions&);
+template void SortBlobT<int32_t>(SortSource&, SortSink&, const SortOptions&);
+template void SortBlobT<int64_t>(SortSource&, SortSink&, const SortOptions&);
+template void SortBlobT<float>(SortSource&, SortSink&, const SortOptions&);
+template void SortBlobT<double>(SortSource&, SortSink&, const SortOptions&);
+
+template void SortBlobT<uint16_t>(const uint16_t*, size_t, const SortedCallback<uint16_t>&, const SortOptions&);
+template void SortBlobT<uint32_t>(const uint32_t*, size_t, const SortedCallback<uint32_t>&, const SortOptions&);
+template void SortBlobT<uint64_t>(const uint64_t*, size_t, const SortedCallback<uint64_t>&, const SortOptions&);
+template void SortBlobT<int16_t>(const int16_t*, size_t, const SortedCallback<int16_t>&, const SortOptions&);
+template void SortBlobT<int32_t>(const int32_t*, size_t, const SortedCallback<int32_t>&, const SortOptions&);
+template void SortBlobT<int64_t>(const int64_t*, size_t, const SortedCallback<int64_t>&, const SortOptions&);
+template void SortBlobT<float>(const float*, size_t, const SortedCallback<float>&, const SortOptions&);
+template void SortBlobT<double>(const double*, size_t, const SortedCallback<double>&, const SortOptions&);
+
+template void PartitionBlobT<uint16_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+template void PartitionBlobT<uint32_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+template void PartitionBlobT<uint64_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+template void PartitionBlobT<int16_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+template void PartitionBlobT<int32_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+template void PartitionBlobT<int64_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+template void PartitionBlobT<float>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+template void PartitionBlobT<double>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+
+void SortBlob32(const std::string& inFilePath, const std::string& outFilePath, const SortOptions& options)
+{
+	SortBlobT<uint32_t>(inFilePath, outFilePath, options);
+}
+
+void SortBlob64(const std::string& inFilePath, const std::string& outFilePath, const SortOptions& options)
+{
+	SortBlobT<uint64_t>(inFilePath, outFilePath, options);
+}
+
 } /* namespace ring */
@@ -8,7 +8,10 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <stdexcept>
+#include <cstdint>
+#include <functional>
 
 namespace ring
 {
@@ -22,20 +25,367 @@ public:
 	}
 };
 
+/**
+ * @brief In-memory sort algorithm used to create sorted runs
+ */
+enum class SortKernel
+{
+	Std, ///< std::sort - comparison based
+	Radix, ///< LSD radix sort - needs a scratch buffer of the chunk size
+};
+
+/**
+ * @brief I/O backend used for file reads and writes
+ *
+ * Each backend falls back to the next simpler one if not supported by the kernel or file system
+ */
+enum class IoBackend
+{
+	Buffered, ///< pread/pwrite through page cache
+	Direct, ///< O_DIRECT - bypasses page cache, the tail not aligned to 4Kb is transferred buffered
+	Uring, ///< io_uring over O_DIRECT - each block is split into requests submitted at once
+};
+
+/**
+ * @brief Placement of temp run files among temp directories
+ */
+enum class TempPlacement
+{
+	RoundRobin, ///< Each next file goes to the next directory
+	FreeSpace, ///< Each next file goes to the directory with the most free space
+};
+
+/**
+ * @brief Counting sort mode
+ *
+ * Values are counted in a single pass over the input, and the output is written from the counts,
+ * with no temp runs. Counts are kept in a table of a key range and a hash table of the other keys,
+ * both within the memory budget. If the input has more distinct values than fit in the counts,
+ * the regular external sort follows the counting pass.
+ */
+enum class CountingMode
+{
+	Off, ///< Always sort by comparison or radix
+	Auto, ///< Count if a sample of the input has few distinct values or a dense range of them
+	Always, ///< Count whenever the input is a file, not a stream
+};
+
+/**
+ * @brief Output of equal values
+ *
+ * Equal values are collapsed in each sorted run and again by each merge,
+ * so runs of repeated values shrink before they are written
+ */
+enum class DuplicateMode
+{
+	Keep, ///< Output all the values
+	Unique, ///< Output each value once, or one record of each key
+	Count, ///< Output each value once followed by its count as uint64_t, packed. Not for records
+};
+
+/**
+ * @brief Sort phase
+ */
+enum class SortPhase
+{
+	RunGeneration, ///< Input is read, sorted and written to runs. Inputs fitting in memory are sorted by this phase only
+	Merge, ///< Runs are merged, including cascade passes
+};
+
+/**
+ * @brief Phase completion callback
+ *
+ * Called from the sorting thread once a phase is complete
+ *
+ * @param phase - completed phase
+ * @param seconds - wall time spent in the phase
+ */
+using PhaseCallback = std::function<void(SortPhase phase, double seconds)>;
+
+/**
+ * @brief Sort statistics
+ *
+ * A snapshot of counters since the sort start. Times of concurrent activities
+ * are summed over the threads, so they may exceed the elapsed time.
+ */
+struct SortStats
+{
+	SortPhase phase = SortPhase::RunGeneration; ///< Current phase
+	bool done = false; ///< Sort is complete - the last report
+	double elapsedSeconds = 0; ///< Wall time since the sort start
+	uintmax_t phaseDone = 0; ///< Bytes processed by the current phase: input sorted into runs or run files merged
+	uintmax_t phaseTotal = 0; ///< Estimated count of bytes the current phase processes, 0 - unknown (streamed input)
+	uintmax_t bytesRead = 0; ///< Bytes read from input and run files. Mapped input is not counted
+	uintmax_t bytesWritten = 0; ///< Bytes written to run files and output. Mapped output is not counted
+	uintmax_t runCount = 0; ///< Count of sorted runs created by run generation
+	uintmax_t mergeCount = 0; ///< Count of completed merges, cascade ones included
+	double readSeconds = 0; ///< Time spent reading input and run files
+	double sortSeconds = 0; ///< Time spent sorting runs in memory
+	double writeSeconds = 0; ///< Time spent writing run files and output
+	double mergeSeconds = 0; ///< Time spent merging runs, including waits for run reads and writes
+	double poolWaitSeconds = 0; ///< Time spent waiting for memory chunks of the pool
+	size_t poolAvailable = 0; ///< Count of memory chunks currently free in the pool
+	size_t taskQueueDepth = 0; ///< Count of tasks waiting for a worker thread, a snapshot taken while tasks come and go
+	size_t readQueueDepth = 0; ///< Count of runs read but not sorted yet by the parallel runs pipeline
+	size_t writeQueueDepth = 0; ///< Count of runs sorted but not written yet by the parallel runs pipeline
+};
+
+/**
+ * @brief Statistics report callback
+ *
+ * Called periodically, on each phase completion and once the sort is complete.
+ * Calls are serialized, but may come from different threads.
+ *
+ * @param stats - current statistics
+ */
+using StatsCallback = std::function<void(const SortStats& stats)>;
+
+/**
+ * @brief I/O bandwidth limit of a time of day window
+ */
+struct BandwidthLimit
+{
+	uintmax_t bytesPerSecond = 0; ///< Max count of bytes read and written per second. 0 - no limit
+	unsigned beginMinute = 0; ///< Minute of day in local time the window begins at
+	unsigned endMinute = 24 * 60; ///< Minute of day in local time the window ends before. Not after begin - the window spans midnight
+};
+
+/**
+ * @brief Sort options
+ *
+ * Zero sizes are derived from the others
+ */
+struct SortOptions
+{
+	uintmax_t memoryBudget = 256ULL << 20; ///< Max allowed memory allocation size. 0 - a half of available RAM (cgroup limit aware)
+	uintmax_t chunkSize = 0; ///< Size of sorted run created in memory. 0 - memory budget split by pool depth
+	unsigned poolDepth = 0; ///< Count of memory chunks in pool. 0 - two per CPU core, or as many as fit the budget if chunk size is set
+	unsigned mergeFanIn = 64; ///< Max count of sorted runs merged in a single pass
+	unsigned threadCount = 0; ///< Count of worker threads sorting and merging runs. 0 - CPU core count
+	SortKernel sortKernel = SortKernel::Radix; ///< In-memory sort algorithm
+	bool mapInput = false; ///< Memory-map input file instead of reading it chunk by chunk
+	IoBackend ioBackend = IoBackend::Buffered; ///< I/O backend used to read input and to write sorted runs and output. Mapped input bypasses it
+	bool parallelRuns = false; ///< Sort each run by all the worker threads, while the next one is read and the previous one is written
+	bool compressRuns = false; ///< Compress temp run files of values by delta and bit-packing encoding. Runs of records are stored as is
+	uintmax_t recordSize = 0; ///< Size of fixed-size records sorted by a leading or embedded value as a key. 0 - values are sorted themselves
+	uintmax_t keyOffset = 0; ///< Offset of the key in record
+	std::vector<std::string> tempDirectories; ///< Directories of temp run files, e.g. one per disk. Empty - system temp directory
+	TempPlacement tempPlacement = TempPlacement::RoundRobin; ///< Placement of temp run files among temp directories
+	CountingMode counting = CountingMode::Off; ///< Counting sort mode of values. Records are never sorted by counting
+	bool adaptive = false; ///< Exploit presorted values: sorted input is copied, sorted or nearly sorted runs skip the sort
+	bool resume = false; ///< Keep temp files of a failed sort to resume it, and reuse the runs a failed sort of the same input left. Not for streamed input
+	uintmax_t limit = 0; ///< Max count of the smallest values, or of records of the smallest keys, to output. 0 - no limit
+	std::string rangeLow; ///< Inclusive lower bound of values or keys to output, parsed as their type. Empty - no bound
+	std::string rangeHigh; ///< Exclusive upper bound of values or keys to output, parsed as their type. Empty - no bound
+	DuplicateMode duplicates = DuplicateMode::Keep; ///< Output of equal values. The limit counts distinct ones unless they are kept
+	uintmax_t indexInterval = 0; ///< Write sparse index of every this many output elements to output path + ".idx", see SparseIndex.h. 0 - no index. Not for streamed output
+	bool numa = false; ///< Split worker threads and memory pool between NUMA nodes, each run is sorted on one node
+	bool hugePages = false; ///< Back memory pool with huge pages - reserved hugetlb pages if enough, transparent ones otherwise
+	unsigned deviceStreams = 0; ///< Max count of concurrent reads and writes of files of each device, so that concurrent merges stay sequential. 0 - no limit
+	std::vector<BandwidthLimit> bandwidthLimits; ///< I/O bandwidth limits, the first one of a window of the current time applies. None - no limit. Mapped input and output bypass them
+	PhaseCallback phaseCallback; ///< Called on each phase completion if set
+	StatsCallback statsCallback; ///< Called with statistics reports if set
+	double statsInterval = 1; ///< Seconds between periodic statistics reports. 0 - no periodic reports
+	std::string traceFile; ///< Write Chrome trace event JSON of per-thread spans of reads, sorts, writes, merges and memory pool waits, with offsets and byte counts as span args, to this file once the sort completes or fails. Empty - no trace
+};
+
+/**
+ * @brief Source of input to sort, read sequentially like standard input
+ */
+class SortSource
+{
+public:
+	virtual ~SortSource() = default;
+
+	/**
+	 * @brief Read next bytes of input
+	 *
+	 * @param buffer - buffer to read to
+	 * @param size - size of buffer in bytes
+	 *
+	 * @return Count of bytes read, up to size. 0 - end of input
+	 */
+	virtual size_t Read(void* buffer, size_t size) = 0;
+};
+
+/**
+ * @brief Sink of sorted output, written sequentially like standard output
+ *
+ * Written by one thread at a time, but not necessarily by the thread which called the sort.
+ */
+class SortSink
+{
+public:
+	virtual ~SortSink() = default;
+
+	/**
+	 * @brief Write next block of output
+	 *
+	 * @param data - block of sorted output
+	 * @param size - size of block in bytes
+	 */
+	virtual void Write(const void* data, size_t size) = 0;
+};
+
+/**
+ * @brief Callback of sorted values, see @ref SortBlobT of values
+ */
+template <typename T>
+using SortedCallback = std::function<void(const T* values, size_t count)>;
+
 /**
  * @brief Sort blob file
  *
  * Sort binary large object file.
- * The file size must be a multiple of 4Gb up to 16Gb.
- * The file is treated as a contigious array of 32-bit unsigned values.
+ * The file is treated as a contigious array of T values, its size must be a multiple of the value size.
+ * Implemented for 16, 32 and 64-bit signed and unsigned integers, float and double.
+ * Signed values are ordered numerically, floating point ones by IEEE total order:
+ * -NaN < -Inf < ... < -0 < +0 < ... < +Inf < +NaN.
+ * If @ref SortOptions::recordSize is set, the file is an array of fixed-size records instead,
+ * sorted by T keys at @ref SortOptions::keyOffset. A record must hold at least
+ * a key and a 32-bit index.
+ *
+ * Path "-" stands for standard input or output, so the sort can be a part of a pipeline.
+ * Socket address "tcp://host:port" stands for a TCP connection: accepted on it for input
+ * (e.g. "tcp://:9000" on any address), connected to for output.
+ * Streamed input is read sequentially into runs, an input of a single run is sorted right to the output.
+ * Streamed output is written sequentially.
+ *
+ * @param[in] inFilePath - input file path (a file to sort), "-" - standard input, or socket address
+ * @param[in] outFilePath - output file path (a file to store sorted values), "-" - standard output,
+ * or socket address
+ * @param[in] options - sort options
+ *
+ * @throw @ref ring::SortException
+ *
+ * @return None
+ */
+template <typename T>
+void SortBlobT(const std::string& inFilePath, const std::string& outFilePath,
+	const SortOptions& options = SortOptions());
+
+extern template void SortBlobT<uint16_t>(const std::string&, const std::string&, const SortOptions&);
+extern template void SortBlobT<uint32_t>(const std::string&, const std::string&, const SortOptions&);
+extern template void SortBlobT<uint64_t>(const std::string&, const std::string&, const SortOptions&);
+extern template void SortBlobT<int16_t>(const std::string&, const std::string&, const SortOptions&);
+extern template void SortBlobT<int32_t>(const std::string&, const std::string&, const SortOptions&);
+extern template void SortBlobT<int64_t>(const std::string&, const std::string&, const SortOptions&);
+extern template void SortBlobT<float>(const std::string&, const std::string&, const SortOptions&);
+extern template void SortBlobT<double>(const std::string&, const std::string&, const SortOptions&);
+
+/**
+ * @brief Sort input read from source to sink
+ *
+ * As @ref SortBlobT of files, with input and output streamed through the source and the sink,
+ * e.g. of memory or of a connection owned by the caller. Only temp runs of an input larger than
+ * a memory chunk are stored in files.
+ *
+ * @param[in] source - input to sort
+ * @param[in] sink - output of sorted values or records, written a merged block at a time
+ * @param[in] options - sort options
+ *
+ * @throw @ref ring::SortException, or any exception thrown by the source or the sink
+ *
+ * @return None
+ */
+template <typename T>
+void SortBlobT(SortSource& source, SortSink& sink, const SortOptions& options = SortOptions());
+
+extern template void SortBlobT<uint16_t>(SortSource&, SortSink&, const SortOptions&);
+extern template void SortBlobT<uint32_t>(SortSource&, SortSink&, const SortOptions&);
+extern template void SortBlobT<uint64_t>(SortSource&, SortSink&, const SortOptions&);
+extern template void SortBlobT<int16_t>(SortSource&, SortSink&, const SortOptions&);
+extern template void SortBlobT<int32_t>(SortSource&, SortSink&, const SortOptions&);
+extern template void SortBlobT<int64_t>(SortSource&, SortSink&, const SortOptions&);
+extern template void SortBlobT<float>(SortSource&, SortSink&, const SortOptions&);
+extern template void SortBlobT<double>(SortSource&, SortSink&, const SortOptions&);
+
+/**
+ * @brief Sort values in memory to callback
+ *
+ * As @ref SortBlobT of a source and a sink, with input of a span of values and output of spans
+ * passed to callback in ascending order. Values are not modified. Records and counted output
+ * are not of T values, so they are not supported.
+ *
+ * @param[in] values, count - values to sort
+ * @param[in] output - callback of sorted values, called a merged block at a time
+ * @param[in] options - sort options
+ *
+ * @throw @ref ring::SortException, or any exception thrown by the callback
+ *
+ * @return None
+ */
+template <typename T>
+void SortBlobT(const T* values, size_t count, const SortedCallback<T>& output,
+	const SortOptions& options = SortOptions());
+
+extern template void SortBlobT<uint16_t>(const uint16_t*, size_t, const SortedCallback<uint16_t>&, const SortOptions&);
+extern template void SortBlobT<uint32_t>(const uint32_t*, size_t, const SortedCallback<uint32_t>&, const SortOptions&);
+extern template void SortBlobT<uint64_t>(const uint64_t*, size_t, const SortedCallback<uint64_t>&, const SortOptions&);
+extern template void SortBlobT<int16_t>(const int16_t*, size_t, const SortedCallback<int16_t>&, const SortOptions&);
+extern template void SortBlobT<int32_t>(const int32_t*, size_t, const SortedCallback<int32_t>&, const SortOptions&);
+extern template void SortBlobT<int64_t>(const int64_t*, size_t, const SortedCallback<int64_t>&, const SortOptions&);
+extern template void SortBlobT<float>(const float*, size_t, const SortedCallback<float>&, const SortOptions&);
+extern template void SortBlobT<double>(const double*, size_t, const SortedCallback<double>&, const SortOptions&);
+
+/**
+ * @brief Partition blob file by ranges of values
+ *
+ * Splits the input of @ref SortBlobT into as many partitions as there are outputs, each of a range
+ * of values or keys, ascending in the order of outputs. Ranges are picked by a sample of the input,
+ * so that partitions are about equal unless values repeat a lot. Sorted separately, e.g. by workers
+ * on other hosts receiving partitions over TCP connections, partitions make shards of the sorted
+ * input to be concatenated in the order of outputs. So a sort of an input too large for a host
+ * scales with the count of hosts.
+ *
+ * Of the options, only @ref SortOptions::recordSize, @ref SortOptions::keyOffset, @ref SortOptions::ioBackend,
+ * @ref SortOptions::deviceStreams and @ref SortOptions::bandwidthLimits are used.
+ *
+ * @param[in] inFilePath - input file path, can't be a stream since it is read twice
+ * @param[in] outFilePaths - output file paths, "-" - standard output, or socket addresses
+ * @param[in] options - sort options
+ *
+ * @throw @ref ring::SortException
+ *
+ * @return None
+ */
+template <typename T>
+void PartitionBlobT(const std::string& inFilePath, const std::vector<std::string>& outFilePaths,
+	const SortOptions& options = SortOptions());
+
+extern template void PartitionBlobT<uint16_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+extern template void PartitionBlobT<uint32_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+extern template void PartitionBlobT<uint64_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+extern template void PartitionBlobT<int16_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+extern template void PartitionBlobT<int32_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+extern template void PartitionBlobT<int64_t>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+extern template void PartitionBlobT<float>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+extern template void PartitionBlobT<double>(const std::string&, const std::vector<std::string>&, const SortOptions&);
+
+/**
+ * @brief Sort blob file of 32-bit unsigned values
+ *
+ * Sort binary large object file.
+ * The file is treated as a contigious array of 32-bit unsigned values, its size must be a multiple of 4.
+ * Input too large for a host may be split by @ref PartitionBlobT for sorts on several hosts.
  *
  * @param[in] inFilePath - input file path (a file to sort)
  * @param[in] outFilePath - output file path (a file to store sorted values)
+ * @param[in] options - sort options
  *
  * @throw @ref ring::SortException
  *
  * @return None
  */
-void SortBlob32(const std::string& inFilePath, const std::string& outFilePath);
+void SortBlob32(const std::string& inFilePath, const std::string& outFilePath,
+	const SortOptions& options = SortOptions());
+
+/**
+ * @brief Sort blob file of 64-bit unsigned values
+ *
+ * Same as @ref SortBlob32 for a contigious array of 64-bit unsigned values
+ */
+void SortBlob64(const std::string& inFilePath, const std::string& outFilePath,
+	const SortOptions& options = SortOptions());
 
 } /* namespace ring */
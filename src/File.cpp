@@ -0,0 +1,790 @@
+/*
+ * @file: File.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#include "File.h"
+
+#include <cstring>
+#include <vector>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+namespace ring
+{
+
+namespace
+{
+
+constexpr auto URING_QUEUE_DEPTH = 32; ///< Max count of requests in flight per file
+constexpr auto URING_REQUEST_SIZE = 1 << 20; ///< 1Mb - Blocks are split into requests of this size
+constexpr auto CONNECT_ATTEMPT_COUNT = 100; ///< Attempts to connect to a socket nobody listens on yet
+constexpr auto CONNECT_RETRY_INTERVAL = std::chrono::milliseconds(100);
+
+/**
+ * @brief Backend is not supported by the kernel or file system
+ */
+class UnsupportedBackend: public std::runtime_error
+{
+public:
+	UnsupportedBackend()
+		: std::runtime_error("Unsupported I/O backend")
+	{
+	}
+};
+
+int OpenFlags(File::Mode mode)
+{
+	return (mode == File::Mode::Read) ? O_RDONLY : (O_WRONLY | O_CREAT | O_TRUNC);
+}
+
+bool IsAligned(const void* buffer, uint64_t offset)
+{
+	return !(reinterpret_cast<uintptr_t>(buffer) % DIRECT_IO_ALIGNMENT) && !(offset % DIRECT_IO_ALIGNMENT);
+}
+
+/**
+ * @brief Read until the block is full or end of file
+ */
+size_t ReadFully(int fd, void* buffer, size_t size, uint64_t offset, const std::string& path)
+{
+	size_t done = 0;
+
+	while (done < size)
+	{
+		auto res = pread(fd, static_cast<char*>(buffer) + done, size - done, offset + done);
+
+		if (res < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (res < 0)
+		{
+			throw SortException("Failed to read " + path + ": " + strerror(errno));
+		}
+
+		if (!res)
+		{
+			break;
+		}
+
+		done += res;
+	}
+
+	return done;
+}
+
+void WriteFully(int fd, const void* buffer, size_t size, uint64_t offset, const std::string& path)
+{
+	size_t done = 0;
+
+	while (done < size)
+	{
+		auto res = pwrite(fd, static_cast<const char*>(buffer) + done, size - done, offset + done);
+
+		if (res < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (res <= 0)
+		{
+			throw SortException("Failed to write " + path + ": " + strerror(errno));
+		}
+
+		done += res;
+	}
+}
+
+/**
+ * @brief Check that a stream is accessed where the previous read or write ended
+ *
+ * @param offset - offset of access
+ * @param position - end of previous access
+ * @param path - stream path
+ */
+void CheckSequential(uint64_t offset, uint64_t position, const std::string& path)
+{
+	if (offset != position)
+	{
+		throw SortException("Non-sequential access to " + path);
+	}
+}
+
+using AddressList = std::unique_ptr<addrinfo, decltype(&freeaddrinfo)>;
+
+/**
+ * @brief Resolve socket address path, see @ref File::Open
+ *
+ * @param path - socket address path
+ * @param passive - resolve address to accept connections on
+ */
+AddressList ResolveSocketAddress(const std::string& path, bool passive)
+{
+	auto address = path.substr(strlen(SOCKET_PATH_PREFIX));
+	auto separator = address.rfind(':');
+
+	if (separator == std::string::npos || separator + 1 == address.size())
+	{
+		throw SortException("Invalid socket address " + path);
+	}
+
+	auto host = address.substr(0, separator);
+	auto port = address.substr(separator + 1);
+
+	// IPv6 address is enclosed in brackets
+	if (host.size() > 1 && host.front() == '[' && host.back() == ']')
+	{
+		host = host.substr(1, host.size() - 2);
+	}
+
+	addrinfo hints {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+	addrinfo* list = nullptr;
+	auto res = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &list);
+
+	if (res)
+	{
+		throw SortException("Failed to resolve " + path + ": " + gai_strerror(res));
+	}
+
+	return AddressList(list, freeaddrinfo);
+}
+
+/**
+ * @brief Connect to socket address
+ *
+ * @return Descriptor of the connected socket
+ */
+int Connect(const std::string& path)
+{
+	auto list = ResolveSocketAddress(path, false);
+
+	for (int attempt = 1;; attempt++)
+	{
+		int error = 0;
+
+		for (auto info = list.get(); info; info = info->ai_next)
+		{
+			int fd = socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+
+			if (fd >= 0 && !connect(fd, info->ai_addr, info->ai_addrlen))
+			{
+				return fd;
+			}
+
+			error = errno;
+
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+		}
+
+		// Peers of a pipeline start at about the same time, so the one to accept may be late
+		if (error != ECONNREFUSED || attempt == CONNECT_ATTEMPT_COUNT)
+		{
+			throw SortException("Failed to connect to " + path + ": " + strerror(error));
+		}
+
+		std::this_thread::sleep_for(CONNECT_RETRY_INTERVAL);
+	}
+}
+
+/**
+ * @brief Accept a single connection on socket address
+ *
+ * @return Descriptor of the accepted socket
+ */
+int Accept(const std::string& path)
+{
+	auto list = ResolveSocketAddress(path, true);
+	int error = 0;
+
+	for (auto info = list.get(); info; info = info->ai_next)
+	{
+		int listener = socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+
+		if (listener < 0)
+		{
+			error = errno;
+			continue;
+		}
+
+		int reuse = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+		if (!bind(listener, info->ai_addr, info->ai_addrlen) && !listen(listener, 1))
+		{
+			int fd = -1;
+
+			while ((fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC)) < 0 && errno == EINTR)
+			{
+			}
+
+			error = errno;
+			close(listener);
+
+			if (fd < 0)
+			{
+				throw SortException("Failed to accept connection on " + path + ": " + strerror(error));
+			}
+
+			return fd;
+		}
+
+		error = errno;
+		close(listener);
+	}
+
+	throw SortException("Failed to listen on " + path + ": " + strerror(error));
+}
+
+/**
+ * @brief Standard input or output, or TCP connection
+ *
+ * Pipes, terminals and sockets can't be accessed at an offset, so reads and writes are sequential
+ */
+class StreamFile: public File
+{
+public:
+	explicit StreamFile(Mode mode)
+		: File((mode == Mode::Read) ? "standard input" : "standard output",
+			dup((mode == Mode::Read) ? STDIN_FILENO : STDOUT_FILENO))
+	{
+	}
+
+	/**
+	 * @brief Open TCP connection, see @ref File::Open
+	 */
+	StreamFile(const std::string& path, Mode mode)
+		: File(path, (mode == Mode::Read) ? Accept(path) : Connect(path))
+			, m_socket(true)
+	{
+	}
+
+	size_t Read(void* buffer, size_t size, uint64_t offset) override
+	{
+		CheckSequential(offset, m_position, m_path);
+
+		size_t done = 0;
+
+		while (done < size)
+		{
+			auto res = read(m_fd, static_cast<char*>(buffer) + done, size - done);
+
+			if (res < 0 && errno == EINTR)
+			{
+				continue;
+			}
+
+			if (res < 0)
+			{
+				throw SortException("Failed to read " + m_path + ": " + strerror(errno));
+			}
+
+			if (!res)
+			{
+				break;
+			}
+
+			done += res;
+		}
+
+		m_position += done;
+		return done;
+	}
+
+	void Write(const void* buffer, size_t size, uint64_t offset) override
+	{
+		CheckSequential(offset, m_position, m_path);
+
+		size_t done = 0;
+
+		while (done < size)
+		{
+			// Closed connection fails the write instead of raising SIGPIPE
+			auto res = m_socket ? send(m_fd, static_cast<const char*>(buffer) + done, size - done, MSG_NOSIGNAL) :
+				write(m_fd, static_cast<const char*>(buffer) + done, size - done);
+
+			if (res < 0 && errno == EINTR)
+			{
+				continue;
+			}
+
+			if (res <= 0)
+			{
+				throw SortException("Failed to write " + m_path + ": " + strerror(errno));
+			}
+
+			done += res;
+		}
+
+		m_position += done;
+	}
+
+private:
+	uint64_t m_position = 0;
+	const bool m_socket = false;
+};
+
+/**
+ * @brief File opened with O_DIRECT
+ *
+ * Aligned part of each block bypasses page cache. Unaligned block parts, e.g. the tail
+ * of a file which size is not a multiple of @ref DIRECT_IO_ALIGNMENT, go through the buffered descriptor.
+ */
+class DirectFile: public File
+{
+public:
+	DirectFile(const std::string& path, Mode mode)
+		: File(path, mode)
+	{
+		// The file is already created and truncated by the buffered descriptor
+		m_directFd = open(path.c_str(), (OpenFlags(mode) & ~(O_CREAT | O_TRUNC)) | O_DIRECT);
+
+		if (m_directFd < 0)
+		{
+			throw UnsupportedBackend();
+		}
+	}
+
+	~DirectFile() noexcept override
+	{
+		close(m_directFd);
+	}
+
+	size_t Read(void* buffer, size_t size, uint64_t offset) override
+	{
+		auto head = AlignedSize(buffer, size, offset);
+		auto done = ReadAligned(buffer, head, offset);
+
+		if (done < head)
+		{
+			return done;
+		}
+
+		return done + File::Read(static_cast<char*>(buffer) + head, size - head, offset + head);
+	}
+
+	void Write(const void* buffer, size_t size, uint64_t offset) override
+	{
+		auto head = AlignedSize(buffer, size, offset);
+
+		WriteAligned(buffer, head, offset);
+		File::Write(static_cast<const char*>(buffer) + head, size - head, offset + head);
+	}
+
+protected:
+	/**
+	 * @brief Size of the block part that can be transferred directly
+	 */
+	static size_t AlignedSize(const void* buffer, size_t size, uint64_t offset)
+	{
+		return IsAligned(buffer, offset) ? size - size % DIRECT_IO_ALIGNMENT : 0;
+	}
+
+	virtual size_t ReadAligned(void* buffer, size_t size, uint64_t offset)
+	{
+		return ReadFully(m_directFd, buffer, size, offset, m_path);
+	}
+
+	virtual void WriteAligned(const void* buffer, size_t size, uint64_t offset)
+	{
+		WriteFully(m_directFd, buffer, size, offset, m_path);
+	}
+
+	int m_directFd = -1;
+};
+
+/**
+ * @brief File accessed through io_uring
+ *
+ * Aligned part of each block is split into requests submitted at once
+ * to the O_DIRECT descriptor, so the device sees a deep queue even from a single thread.
+ * Talks to the kernel through raw system calls - there is no dependency on liburing.
+ */
+class UringFile: public DirectFile
+{
+public:
+	UringFile(const std::string& path, Mode mode)
+		: DirectFile(path, mode)
+	{
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+
+		m_ringFd = syscall(__NR_io_uring_setup, URING_QUEUE_DEPTH, &params);
+
+		if (m_ringFd < 0)
+		{
+			throw UnsupportedBackend();
+		}
+
+		m_sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		m_cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+		if (params.features & IORING_FEAT_SINGLE_MMAP)
+		{
+			m_sqSize = m_cqSize = std::max(m_sqSize, m_cqSize);
+		}
+
+		m_sq = Map(m_sqSize, IORING_OFF_SQ_RING);
+		m_cq = (params.features & IORING_FEAT_SINGLE_MMAP) ? m_sq : Map(m_cqSize, IORING_OFF_CQ_RING);
+		m_sqes = static_cast<io_uring_sqe*>(Map(m_sqesSize, IORING_OFF_SQES));
+
+		auto sq = static_cast<char*>(m_sq);
+		auto cq = static_cast<char*>(m_cq);
+
+		m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		m_sqEntries = params.sq_entries;
+		m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+	}
+
+	~UringFile() noexcept override
+	{
+		Unmap();
+	}
+
+protected:
+	size_t ReadAligned(void* buffer, size_t size, uint64_t offset) override
+	{
+		return Transfer(IORING_OP_READV, static_cast<char*>(buffer), size, offset);
+	}
+
+	void WriteAligned(const void* buffer, size_t size, uint64_t offset) override
+	{
+		Transfer(IORING_OP_WRITEV, static_cast<char*>(const_cast<void*>(buffer)), size, offset);
+	}
+
+private:
+	void* Map(size_t size, off_t offset)
+	{
+		auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, offset);
+
+		if (ptr == MAP_FAILED)
+		{
+			Unmap();
+			throw UnsupportedBackend();
+		}
+
+		return ptr;
+	}
+
+	void Unmap() noexcept
+	{
+		if (m_sqes)
+		{
+			munmap(m_sqes, m_sqesSize);
+		}
+
+		if (m_cq && m_cq != m_sq)
+		{
+			munmap(m_cq, m_cqSize);
+		}
+
+		if (m_sq)
+		{
+			munmap(m_sq, m_sqSize);
+		}
+
+		close(m_ringFd);
+	}
+
+	/**
+	 * @brief Transfer block split into requests
+	 *
+	 * Keeps up to the queue depth requests in flight. Requests completed partially
+	 * (e.g. at the end of file) are finished with plain system calls.
+	 *
+	 * @return Count of bytes transferred
+	 */
+	size_t Transfer(uint8_t opcode, char* buffer, size_t size, uint64_t offset)
+	{
+		auto count = (size + URING_REQUEST_SIZE - 1) / URING_REQUEST_SIZE;
+		std::vector<iovec> requests(count);
+		std::vector<int> results(count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			requests[i].iov_base = buffer + i * URING_REQUEST_SIZE;
+			requests[i].iov_len = std::min<size_t>(URING_REQUEST_SIZE, size - i * URING_REQUEST_SIZE);
+		}
+
+		size_t next = 0;
+		size_t completed = 0;
+		unsigned inFlight = 0;
+		unsigned unsubmitted = 0;
+
+		while (completed < count)
+		{
+			auto tail = *m_sqTail;
+
+			for (; next < count && inFlight < m_sqEntries; next++, inFlight++, unsubmitted++, tail++)
+			{
+				auto index = tail & m_sqMask;
+				auto& sqe = m_sqes[index];
+
+				memset(&sqe, 0, sizeof(sqe));
+				sqe.opcode = opcode;
+				sqe.fd = m_directFd;
+				sqe.addr = reinterpret_cast<uintptr_t>(&requests[next]);
+				sqe.len = 1;
+				sqe.off = RequestOffset(offset, next);
+				sqe.user_data = next;
+
+				m_sqArray[index] = index;
+			}
+
+			__atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+
+			auto res = syscall(__NR_io_uring_enter, m_ringFd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+			if (res < 0 && errno != EINTR)
+			{
+				throw SortException("io_uring failure on " + m_path + ": " + strerror(errno));
+			}
+
+			unsubmitted -= (res > 0) ? res : 0;
+
+			auto head = *m_cqHead;
+			for (; head != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE); head++, inFlight--, completed++)
+			{
+				const auto& cqe = m_cqes[head & m_cqMask];
+				results[cqe.user_data] = cqe.res;
+			}
+
+			__atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+		}
+
+		size_t done = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (results[i] < 0)
+			{
+				throw SortException("Failed to " + std::string(opcode == IORING_OP_READV ? "read " : "write ") +
+					m_path + ": " + strerror(-results[i]));
+			}
+
+			auto request = static_cast<char*>(requests[i].iov_base);
+			auto length = requests[i].iov_len;
+
+			if (static_cast<size_t>(results[i]) == length)
+			{
+				done += length;
+				continue;
+			}
+
+			// Short transfer - finish the rest in the unaligned tail friendly way
+			if (opcode == IORING_OP_READV)
+			{
+				auto rest = File::Read(request + results[i], length - results[i], RequestOffset(offset, i) + results[i]);
+				done += results[i] + rest;
+
+				if (results[i] + rest < length)
+				{
+					return done;
+				}
+			}
+			else
+			{
+				File::Write(request + results[i], length - results[i], RequestOffset(offset, i) + results[i]);
+				done += length;
+			}
+		}
+
+		return done;
+	}
+
+	static uint64_t RequestOffset(uint64_t offset, size_t index)
+	{
+		return offset + index * URING_REQUEST_SIZE;
+	}
+
+	int m_ringFd = -1;
+	void* m_sq = nullptr;
+	void* m_cq = nullptr;
+	io_uring_sqe* m_sqes = nullptr;
+	size_t m_sqSize = 0;
+	size_t m_cqSize = 0;
+	size_t m_sqesSize = 0;
+
+	unsigned* m_sqTail = nullptr;
+	unsigned m_sqMask = 0;
+	unsigned* m_sqArray = nullptr;
+	unsigned m_sqEntries = 0;
+	unsigned* m_cqHead = nullptr;
+	unsigned* m_cqTail = nullptr;
+	unsigned m_cqMask = 0;
+	io_uring_cqe* m_cqes = nullptr;
+};
+
+}
+
+File::File(const std::string& path, Mode mode)
+	: m_path(path)
+{
+	m_fd = open(path.c_str(), OpenFlags(mode), 0644);
+
+	if (m_fd < 0)
+	{
+		throw SortException("Failed to open " + path + ": " + strerror(errno));
+	}
+
+	// Files are read sequentially, a run or a chunk at a time, so let the kernel read ahead further
+	if (mode == Mode::Read)
+	{
+		posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+}
+
+File::File(const std::string& path, int fd)
+	: m_path(path)
+		, m_fd(fd)
+{
+	if (m_fd < 0)
+	{
+		throw SortException("Failed to open " + path + ": " + strerror(errno));
+	}
+}
+
+File::File(const std::string& path)
+	: m_path(path)
+{
+}
+
+File::~File() noexcept
+{
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+	}
+}
+
+std::unique_ptr<File> File::Open(const std::string& path, Mode mode, IoBackend backend)
+{
+	if (IsStandardStream(path))
+	{
+		return std::unique_ptr<File>(new StreamFile(mode));
+	}
+
+	if (IsSocketAddress(path))
+	{
+		return std::unique_ptr<File>(new StreamFile(path, mode));
+	}
+
+	try
+	{
+		switch (backend)
+		{
+		case IoBackend::Uring:
+			return std::unique_ptr<File>(new UringFile(path, mode));
+		case IoBackend::Direct:
+			return std::unique_ptr<File>(new DirectFile(path, mode));
+		case IoBackend::Buffered:
+			break;
+		}
+	}
+	catch (const UnsupportedBackend&)
+	{
+		if (backend == IoBackend::Uring)
+		{
+			return Open(path, mode, IoBackend::Direct);
+		}
+	}
+
+	return std::unique_ptr<File>(new File(path, mode));
+}
+
+size_t File::Read(void* buffer, size_t size, uint64_t offset)
+{
+	return ReadFully(m_fd, buffer, size, offset, m_path);
+}
+
+void File::Write(const void* buffer, size_t size, uint64_t offset)
+{
+	WriteFully(m_fd, buffer, size, offset, m_path);
+}
+
+uint64_t File::Device() const
+{
+	struct stat st;
+
+	return (m_fd >= 0 && !fstat(m_fd, &st) && S_ISREG(st.st_mode)) ? st.st_dev : 0;
+}
+
+SourceFile::SourceFile(SortSource& source)
+	: File("sort source")
+		, m_source(source)
+{
+}
+
+size_t SourceFile::Read(void* buffer, size_t size, uint64_t offset)
+{
+	CheckSequential(offset, m_position, m_path);
+
+	size_t done = 0;
+
+	while (done < size)
+	{
+		auto res = m_source.Read(static_cast<char*>(buffer) + done, size - done);
+
+		if (!res)
+		{
+			break;
+		}
+
+		done += res;
+	}
+
+	m_position += done;
+	return done;
+}
+
+void SourceFile::Write(const void*, size_t, uint64_t)
+{
+	throw SortException("Failed to write " + m_path + ": it is read only");
+}
+
+SinkFile::SinkFile(SortSink& sink)
+	: File("sort sink")
+		, m_sink(sink)
+{
+}
+
+size_t SinkFile::Read(void*, size_t, uint64_t)
+{
+	throw SortException("Failed to read " + m_path + ": it is write only");
+}
+
+void SinkFile::Write(const void* buffer, size_t size, uint64_t offset)
+{
+	CheckSequential(offset, m_position, m_path);
+
+	m_sink.Write(buffer, size);
+	m_position += size;
+}
+
+} /* namespace ring */
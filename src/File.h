@@ -0,0 +1,209 @@
+/*
+ * @file: File.h
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "BlobSort.h"
+
+namespace ring
+{
+
+constexpr size_t DIRECT_IO_ALIGNMENT = 4096; ///< 4Kb - O_DIRECT buffers, offsets and sizes must be multiples of this
+constexpr auto STANDARD_STREAM_PATH = "-"; ///< Path of standard input or output
+constexpr auto SOCKET_PATH_PREFIX = "tcp://"; ///< Prefix of TCP socket address paths, e.g. "tcp://host:9000"
+
+/**
+ * @brief Check if path refers to standard input or output
+ */
+inline bool IsStandardStream(const std::string& path)
+{
+	return path == STANDARD_STREAM_PATH;
+}
+
+/**
+ * @brief Check if path is a TCP socket address
+ */
+inline bool IsSocketAddress(const std::string& path)
+{
+	return !path.compare(0, strlen(SOCKET_PATH_PREFIX), SOCKET_PATH_PREFIX);
+}
+
+/**
+ * @brief Check if path refers to a stream - standard input or output, or a TCP connection
+ */
+inline bool IsStream(const std::string& path)
+{
+	return IsStandardStream(path) || IsSocketAddress(path);
+}
+
+struct FreeDeleter
+{
+	void operator()(void* ptr) const noexcept
+	{
+		free(ptr);
+	}
+};
+
+template <typename T>
+using AlignedBuffer = std::unique_ptr<T[], FreeDeleter>;
+
+/**
+ * @brief Allocate buffer suitable for direct I/O
+ *
+ * Memory is not initialized, so pages are only committed when touched
+ *
+ * @param count - count of objects
+ *
+ * @throw std::bad_alloc
+ *
+ * @return Buffer aligned to @ref DIRECT_IO_ALIGNMENT
+ */
+template <typename T>
+AlignedBuffer<T> AllocateAligned(size_t count)
+{
+	auto size = (count * sizeof(T) + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+	auto ptr = aligned_alloc(DIRECT_IO_ALIGNMENT, std::max<size_t>(size, DIRECT_IO_ALIGNMENT));
+
+	if (!ptr)
+	{
+		throw std::bad_alloc();
+	}
+
+	return AlignedBuffer<T>(static_cast<T*>(ptr));
+}
+
+/**
+ * @brief File opened with one of I/O backends
+ *
+ * Positional reads and writes of large blocks.
+ * Not thread safe - each file is accessed by one thread at a time.
+ * Standard input and output are files too, accessed sequentially only, and so are TCP connections
+ * and sources and sinks of sorts, see @ref SourceFile and @ref SinkFile.
+ */
+class File
+{
+public:
+	enum class Mode
+	{
+		Read, ///< Open existing file for reading
+		Write, ///< Create or truncate file for writing
+	};
+
+	File(const File&) = delete;
+	File& operator=(const File&) = delete;
+
+	/**
+	 * @brief Open file
+	 *
+	 * Falls back to the next simpler backend if the requested one is not supported
+	 * by the kernel or file system: io_uring to O_DIRECT, O_DIRECT to buffered.
+	 * Standard input or output is opened for @ref STANDARD_STREAM_PATH regardless of backend,
+	 * each next read or write must start where the previous one ended.
+	 * TCP connection is opened the same way for a socket address "tcp://host:port": it is connected to
+	 * for writing, and a single connection is accepted on it for reading, the host may be empty then
+	 * to accept on any address.
+	 *
+	 * @param path - file path
+	 * @param mode - open mode
+	 * @param backend - I/O backend
+	 *
+	 * @throw @ref ring::SortException
+	 *
+	 * @return Opened file
+	 */
+	static std::unique_ptr<File> Open(const std::string& path, Mode mode, IoBackend backend);
+
+	virtual ~File() noexcept;
+
+	/**
+	 * @brief Read block
+	 *
+	 * @param buffer - buffer to read to
+	 * @param size - size of block in bytes
+	 * @param offset - file offset
+	 *
+	 * @throw @ref ring::SortException
+	 *
+	 * @return Count of bytes read. Less than size only at the end of file
+	 */
+	virtual size_t Read(void* buffer, size_t size, uint64_t offset);
+
+	/**
+	 * @brief Write block
+	 *
+	 * @param buffer - buffer to write
+	 * @param size - size of block in bytes
+	 * @param offset - file offset
+	 *
+	 * @throw @ref ring::SortException
+	 */
+	virtual void Write(const void* buffer, size_t size, uint64_t offset);
+
+	/**
+	 * @brief Device of the file system the file is on
+	 *
+	 * @return Device id, 0 if the file is not a regular one, e.g. a stream
+	 */
+	uint64_t Device() const;
+
+protected:
+	File(const std::string& path, Mode mode);
+
+	/**
+	 * @brief Construct file of an open descriptor, takes ownership of it
+	 */
+	File(const std::string& path, int fd);
+
+	/**
+	 * @brief Construct file of no descriptor, for files overriding both reads and writes
+	 */
+	explicit File(const std::string& path);
+
+	const std::string m_path;
+	int m_fd = -1;
+};
+
+/**
+ * @brief Source of a sort read as a file, sequentially like a stream
+ */
+class SourceFile: public File
+{
+public:
+	explicit SourceFile(SortSource& source);
+
+	size_t Read(void* buffer, size_t size, uint64_t offset) override;
+	void Write(const void* buffer, size_t size, uint64_t offset) override;
+
+private:
+	SortSource& m_source;
+	uint64_t m_position = 0;
+};
+
+/**
+ * @brief Sink of a sort written as a file, sequentially like a stream
+ */
+class SinkFile: public File
+{
+public:
+	explicit SinkFile(SortSink& sink);
+
+	size_t Read(void* buffer, size_t size, uint64_t offset) override;
+	void Write(const void* buffer, size_t size, uint64_t offset) override;
+
+private:
+	SortSink& m_sink;
+	uint64_t m_position = 0;
+};
+
+} /* namespace ring */
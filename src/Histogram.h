@@ -0,0 +1,163 @@
+/*
+ * @file: Histogram.h
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+namespace ring
+{
+
+/**
+ * @brief Counts of unsigned keys
+ *
+ * Keys of a window [low, low + window size) are counted in a direct table,
+ * the rest in an open addressing hash table of a fixed capacity filled at most by a half.
+ * Either part may be empty, e.g. the window covers the whole space of 16-bit keys,
+ * and keys of few distinct values only need the hash table.
+ */
+template <typename Key>
+class KeyHistogram
+{
+	static_assert(std::is_unsigned<Key>::value, "Keys must be unsigned");
+
+public:
+	/**
+	 * @brief Entry of the hash table, size of the table is its capacity times this
+	 */
+	struct Entry
+	{
+		Key key;
+		uint64_t count; ///< 0 - empty entry
+	};
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param low - the first key of the window
+	 * @param windowSize - count of keys in the window, low + windowSize must not exceed the key space
+	 * @param hashCapacity - count of hash table entries, 0 or a power of two
+	 */
+	KeyHistogram(Key low, size_t windowSize, size_t hashCapacity)
+		: m_low(low)
+			, m_window(windowSize)
+			, m_entries(hashCapacity)
+			, m_mask(hashCapacity - 1)
+	{
+		while (hashCapacity >>= 1)
+		{
+			m_hashBits++;
+		}
+	}
+
+	/**
+	 * @brief Count key
+	 *
+	 * @return false if the hash table is full, the key is not counted then
+	 */
+	bool Add(Key key)
+	{
+		uint64_t index = static_cast<Key>(key - m_low);
+
+		if (index < m_window.size())
+		{
+			m_window[index]++;
+			return true;
+		}
+
+		if (m_entries.empty())
+		{
+			return false;
+		}
+
+		// Fibonacci hashing spreads dense key ranges over the whole table
+		for (auto i = Hash(key);; i = (i + 1) & m_mask)
+		{
+			auto& entry = m_entries[i];
+
+			if (entry.count && entry.key == key)
+			{
+				entry.count++;
+				return true;
+			}
+
+			if (!entry.count)
+			{
+				if (m_hashSize * 2 >= m_entries.size())
+				{
+					return false;
+				}
+
+				entry = { key, 1 };
+				m_hashSize++;
+				return true;
+			}
+		}
+	}
+
+	/**
+	 * @brief Call func(key, count) for each counted key in ascending order
+	 */
+	template <typename F>
+	void ForEach(F func) const
+	{
+		std::vector<Entry> hashed;
+		hashed.reserve(m_hashSize);
+
+		for (const auto& entry : m_entries)
+		{
+			if (entry.count)
+			{
+				hashed.push_back(entry);
+			}
+		}
+
+		std::sort(hashed.begin(), hashed.end(), [](const Entry& left, const Entry& right)
+		{	return left.key < right.key;});
+
+		// Hashed keys are all outside of the window
+		auto above = std::partition_point(hashed.cbegin(), hashed.cend(),
+			[this](const Entry& entry) { return entry.key < m_low; });
+
+		for (auto entry = hashed.cbegin(); entry != above; ++entry)
+		{
+			func(entry->key, entry->count);
+		}
+
+		for (size_t i = 0; i < m_window.size(); i++)
+		{
+			if (m_window[i])
+			{
+				func(static_cast<Key>(m_low + i), m_window[i]);
+			}
+		}
+
+		for (auto entry = above; entry != hashed.cend(); ++entry)
+		{
+			func(entry->key, entry->count);
+		}
+	}
+
+private:
+	size_t Hash(Key key) const
+	{
+		return m_hashBits ? (uint64_t(key) * 0x9E3779B97F4A7C15ULL) >> (64 - m_hashBits) : 0;
+	}
+
+	const Key m_low;
+	std::vector<uint64_t> m_window;
+	std::vector<Entry> m_entries;
+	const size_t m_mask;
+	unsigned m_hashBits = 0;
+	size_t m_hashSize = 0; ///< Count of occupied entries
+};
+
+} /* namespace ring */
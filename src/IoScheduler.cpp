@@ -0,0 +1,131 @@
+/*
+ * @file: IoScheduler.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#include "IoScheduler.h"
+
+#include <thread>
+#include <ctime>
+
+namespace ring
+{
+
+namespace
+{
+
+constexpr unsigned MINUTES_PER_DAY = 24 * 60;
+
+bool InWindow(const BandwidthLimit& limit, unsigned minute)
+{
+	return (limit.beginMinute < limit.endMinute) ? (minute >= limit.beginMinute && minute < limit.endMinute) :
+		(minute >= limit.beginMinute || minute < limit.endMinute);
+}
+
+}
+
+IoScheduler::Grant::Grant(IoScheduler* scheduler, uint64_t device, size_t size)
+	: m_device(device)
+{
+	if (!scheduler || !scheduler->Active())
+	{
+		return;
+	}
+
+	scheduler->Pace(size);
+
+	if (scheduler->m_deviceStreams && device)
+	{
+		scheduler->AcquireStream(device);
+		m_scheduler = scheduler;
+	}
+}
+
+IoScheduler::Grant::~Grant() noexcept
+{
+	if (m_scheduler)
+	{
+		m_scheduler->ReleaseStream(m_device);
+	}
+}
+
+IoScheduler::IoScheduler(unsigned deviceStreams, std::vector<BandwidthLimit> limits)
+	: m_deviceStreams(deviceStreams)
+		, m_limits(std::move(limits))
+		, m_next(std::chrono::steady_clock::now())
+{
+	for (const auto& limit : m_limits)
+	{
+		if (limit.beginMinute >= MINUTES_PER_DAY || limit.endMinute > MINUTES_PER_DAY)
+		{
+			throw SortException("Invalid bandwidth limit window");
+		}
+	}
+}
+
+uintmax_t IoScheduler::CurrentLimit() const
+{
+	if (m_limits.empty())
+	{
+		return 0;
+	}
+
+	auto now = time(nullptr);
+	tm local = {};
+	localtime_r(&now, &local);
+	unsigned minute = local.tm_hour * 60 + local.tm_min;
+
+	for (const auto& limit : m_limits)
+	{
+		if (InWindow(limit, minute))
+		{
+			return limit.bytesPerSecond;
+		}
+	}
+
+	return 0;
+}
+
+void IoScheduler::Pace(size_t size)
+{
+	auto limit = CurrentLimit();
+
+	if (!limit)
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point start;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Idle time is not saved up for bursts
+		start = std::max(m_next, std::chrono::steady_clock::now());
+		m_next = start + std::chrono::nanoseconds(static_cast<int64_t>(size * 1e9 / limit));
+	}
+
+	std::this_thread::sleep_until(start);
+}
+
+void IoScheduler::AcquireStream(uint64_t device)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto& streams = m_streams[device];
+
+	m_released.wait(lock, [&]() { return streams < m_deviceStreams; });
+	streams++;
+}
+
+void IoScheduler::ReleaseStream(uint64_t device)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_streams[device]--;
+	}
+
+	m_released.notify_all();
+}
+
+} /* namespace ring */
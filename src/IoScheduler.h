@@ -0,0 +1,97 @@
+/*
+ * @file: IoScheduler.h
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+#include "BlobSort.h"
+
+namespace ring
+{
+
+/**
+ * @brief Scheduler of reads and writes of a sort
+ *
+ * Limits the count of concurrent reads and writes of each device, so that a disk serves a few large
+ * sequential requests at a time instead of interleaving all the runs merged at once.
+ * Paces all the reads and writes to the bandwidth limit of the current time of day:
+ * each request starts no earlier than the previous ones would take at the limit.
+ */
+class IoScheduler
+{
+public:
+	IoScheduler(const IoScheduler&) = delete;
+	IoScheduler& operator=(const IoScheduler&) = delete;
+
+	/**
+	 * @brief Permission for a read or write, a RAII helper held while it is done
+	 */
+	class Grant
+	{
+	public:
+		Grant(const Grant&) = delete;
+		Grant& operator=(const Grant&) = delete;
+
+		/**
+		 * @brief Wait for permission
+		 *
+		 * @param scheduler - scheduler, nullptr - no limits
+		 * @param device - device of the file, see @ref File::Device, 0 - not limited by device
+		 * @param size - count of bytes to read or write
+		 */
+		Grant(IoScheduler* scheduler, uint64_t device, size_t size);
+		~Grant() noexcept;
+
+	private:
+		IoScheduler* m_scheduler = nullptr; ///< Scheduler of the device stream taken, if any
+		const uint64_t m_device;
+	};
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param deviceStreams - max count of concurrent reads and writes of each device, 0 - no limit
+	 * @param limits - bandwidth limits, see @ref SortOptions::bandwidthLimits
+	 */
+	IoScheduler(unsigned deviceStreams, std::vector<BandwidthLimit> limits);
+
+	/**
+	 * @brief Check if there is any limit
+	 */
+	bool Active() const
+	{
+		return m_deviceStreams || !m_limits.empty();
+	}
+
+private:
+	/**
+	 * @brief Bandwidth limit of the current local time
+	 *
+	 * @return Bytes per second, 0 - no limit
+	 */
+	uintmax_t CurrentLimit() const;
+
+	void Pace(size_t size);
+	void AcquireStream(uint64_t device);
+	void ReleaseStream(uint64_t device);
+
+	const unsigned m_deviceStreams;
+	const std::vector<BandwidthLimit> m_limits;
+	std::mutex m_mutex;
+	std::condition_variable m_released;
+	std::map<uint64_t, unsigned> m_streams; ///< Count of reads and writes in progress by device
+	std::chrono::steady_clock::time_point m_next; ///< The next request may start at this time under bandwidth limit
+};
+
+} /* namespace ring */
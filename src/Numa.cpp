@@ -0,0 +1,152 @@
+/*
+ * @file: Numa.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#include "Numa.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+
+#include <cstdlib>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace ring
+{
+
+namespace Numa
+{
+
+namespace
+{
+
+constexpr auto NODE_PATH = "/sys/devices/system/node/";
+constexpr auto MPOL_PREFERRED = 1; ///< From linux/mempolicy.h - allocate on the node, fall back to others
+constexpr auto BITS_PER_MASK_WORD = sizeof(unsigned long) * 8;
+
+std::string ReadLine(const std::string& path)
+{
+	std::ifstream strm(path);
+	std::string line;
+
+	std::getline(strm, line);
+	return line;
+}
+
+}
+
+std::vector<unsigned> ParseList(const std::string& list)
+{
+	std::vector<unsigned> numbers;
+	std::istringstream strm(list);
+
+	for (std::string range; std::getline(strm, range, ',');)
+	{
+		char* end = nullptr;
+		auto first = strtoul(range.c_str(), &end, 10);
+		auto last = first;
+
+		if (end == range.c_str())
+		{
+			return {};
+		}
+
+		if (*end == '-')
+		{
+			auto lastBegin = end + 1;
+			last = strtoul(lastBegin, &end, 10);
+
+			if (end == lastBegin || last < first)
+			{
+				return {};
+			}
+		}
+
+		if (*end != '\0')
+		{
+			return {};
+		}
+
+		for (auto number = first; number <= last; number++)
+		{
+			numbers.push_back(number);
+		}
+	}
+
+	std::sort(numbers.begin(), numbers.end());
+	numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+
+	return numbers;
+}
+
+std::vector<Node> Nodes()
+{
+	std::vector<Node> nodes;
+
+	for (auto id : ParseList(ReadLine(std::string(NODE_PATH) + "online")))
+	{
+		auto cpus = ParseList(ReadLine(std::string(NODE_PATH) + "node" + std::to_string(id) + "/cpulist"));
+
+		if (!cpus.empty())
+		{
+			nodes.push_back({ id, std::move(cpus) });
+		}
+	}
+
+	if (nodes.empty())
+	{
+		Node node { 0, {} };
+		for (unsigned cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); cpu++)
+		{
+			node.cpus.push_back(cpu);
+		}
+
+		nodes.push_back(std::move(node));
+	}
+
+	return nodes;
+}
+
+unsigned CurrentNode()
+{
+	unsigned cpu = 0;
+	unsigned node = 0;
+
+	return syscall(SYS_getcpu, &cpu, &node, nullptr) ? 0 : node;
+}
+
+void PinThread(const std::vector<unsigned>& cpus)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	for (auto cpu : cpus)
+	{
+		if (cpu < CPU_SETSIZE)
+		{
+			CPU_SET(cpu, &set);
+		}
+	}
+
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+void PreferNode(void* data, size_t size, unsigned node)
+{
+	std::vector<unsigned long> mask(node / BITS_PER_MASK_WORD + 1);
+	mask[node / BITS_PER_MASK_WORD] = 1UL << (node % BITS_PER_MASK_WORD);
+
+	// The kernel takes one bit less than maxnode
+	syscall(SYS_mbind, data, size, MPOL_PREFERRED, mask.data(), mask.size() * BITS_PER_MASK_WORD + 1, 0);
+}
+
+} /* namespace Numa */
+
+} /* namespace ring */
@@ -0,0 +1,70 @@
+/*
+ * @file: Numa.h
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace ring
+{
+
+/**
+ * @brief NUMA topology and placement
+ *
+ * Topology is read from sysfs, placement is done by system calls directly,
+ * so there is no dependency on libnuma. All of the calls are best effort:
+ * a host without NUMA support looks like a single node.
+ */
+namespace Numa
+{
+
+/**
+ * @brief NUMA node having CPUs
+ */
+struct Node
+{
+	unsigned id; ///< Node number as known to the kernel
+	std::vector<unsigned> cpus; ///< CPUs of the node
+};
+
+/**
+ * @brief Parse CPU or node list, e.g. "0-3,8-11"
+ *
+ * @return Listed numbers in ascending order, empty if the list is malformed
+ */
+std::vector<unsigned> ParseList(const std::string& list);
+
+/**
+ * @brief Online nodes having CPUs
+ *
+ * @return Nodes sorted by id. A single node of all the CPUs if topology is unknown
+ */
+std::vector<Node> Nodes();
+
+/**
+ * @brief Node of the CPU the calling thread runs on
+ */
+unsigned CurrentNode();
+
+/**
+ * @brief Pin the calling thread to CPUs
+ */
+void PinThread(const std::vector<unsigned>& cpus);
+
+/**
+ * @brief Prefer node for pages of memory range not committed yet
+ *
+ * @param data, size - memory range, page aligned
+ * @param node - node id
+ */
+void PreferNode(void* data, size_t size, unsigned node);
+
+} /* namespace Numa */
+
+} /* namespace ring */
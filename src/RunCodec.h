@@ -0,0 +1,173 @@
+/*
+ * @file: RunCodec.h
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
+
+namespace ring
+{
+
+/**
+ * @brief Sorted run codec
+ *
+ * Sorted unsigned keys are stored in frames of up to @ref FRAME_KEY_COUNT keys:
+ *
+ *     uint8_t count - count of keys in frame minus one
+ *     uint8_t width - bit width of deltas
+ *     Key base - the first key
+ *     deltas between adjacent keys, packed LSB first, padded to a whole byte
+ *
+ * Deltas of sorted keys are small, e.g. runs of a million random 32-bit values
+ * take 13 bits per value, and runs of equal values take no bits at all.
+ * Frames are stored in host byte order - run files are temporary.
+ */
+namespace RunCodec
+{
+
+constexpr size_t FRAME_KEY_COUNT = 128;
+
+template <typename Key>
+constexpr size_t HeaderSize()
+{
+	return 2 + sizeof(Key);
+}
+
+template <typename Key>
+constexpr size_t MaxFrameSize()
+{
+	return HeaderSize<Key>() + ((FRAME_KEY_COUNT - 1) * sizeof(Key) * 8 + 7) / 8;
+}
+
+/**
+ * @brief Count of bytes past the frame end the decoder may read
+ */
+constexpr size_t DECODE_PADDING = sizeof(uint64_t);
+
+inline uint64_t ShiftRight(uint64_t value, unsigned shift)
+{
+	return (shift < 64) ? value >> shift : 0;
+}
+
+/**
+ * @brief Size of frame payload following the header
+ *
+ * @param header - frame header of @ref HeaderSize bytes
+ */
+template <typename Key>
+size_t PayloadSize(const char* header)
+{
+	auto count = static_cast<uint8_t>(header[0]);
+	auto width = static_cast<uint8_t>(header[1]);
+
+	return (count * width + 7) / 8;
+}
+
+/**
+ * @brief Encode frame of sorted keys
+ *
+ * @param keys - sorted keys
+ * @param count - count of keys, 1 to @ref FRAME_KEY_COUNT
+ * @param frame - buffer of @ref MaxFrameSize bytes
+ *
+ * @return Frame size in bytes
+ */
+template <typename Key>
+size_t EncodeFrame(const Key* keys, size_t count, char* frame)
+{
+	static_assert(std::is_unsigned<Key>::value, "Keys must be unsigned");
+
+	unsigned width = 0;
+	for (size_t i = 1; i < count; i++)
+	{
+		auto delta = static_cast<uint64_t>(keys[i] - keys[i - 1]);
+		width = std::max<unsigned>(width, delta ? 64 - __builtin_clzll(delta) : 0);
+	}
+
+	frame[0] = static_cast<char>(count - 1);
+	frame[1] = static_cast<char>(width);
+	memcpy(frame + 2, &keys[0], sizeof(Key));
+
+	auto out = frame + HeaderSize<Key>();
+	uint64_t bits = 0;
+	unsigned filled = 0;
+
+	for (size_t i = 1; width && i < count; i++)
+	{
+		auto delta = static_cast<uint64_t>(keys[i] - keys[i - 1]);
+
+		bits |= delta << filled;
+		filled += width;
+
+		if (filled >= 64)
+		{
+			memcpy(out, &bits, sizeof(bits));
+			out += sizeof(bits);
+			filled -= 64;
+			bits = filled ? delta >> (width - filled) : 0;
+		}
+	}
+
+	memcpy(out, &bits, (filled + 7) / 8);
+
+	return HeaderSize<Key>() + PayloadSize<Key>(frame);
+}
+
+/**
+ * @brief Decode frame
+ *
+ * @param frame - frame followed by at least @ref DECODE_PADDING readable bytes
+ * @param keys - buffer of @ref FRAME_KEY_COUNT keys
+ *
+ * @return Count of keys
+ */
+template <typename Key>
+size_t DecodeFrame(const char* frame, Key* keys)
+{
+	size_t count = static_cast<uint8_t>(frame[0]) + 1;
+	unsigned width = static_cast<uint8_t>(frame[1]);
+	auto mask = (width < 64) ? (uint64_t(1) << width) - 1 : ~uint64_t(0);
+
+	memcpy(&keys[0], frame + 2, sizeof(Key));
+
+	auto in = frame + HeaderSize<Key>();
+	uint64_t bits = 0;
+	unsigned available = 0;
+
+	for (size_t i = 1; i < count; i++)
+	{
+		uint64_t delta = 0;
+
+		if (available >= width)
+		{
+			delta = bits & mask;
+			bits = ShiftRight(bits, width);
+			available -= width;
+		}
+		else
+		{
+			uint64_t next;
+			memcpy(&next, in, sizeof(next));
+			in += sizeof(next);
+
+			delta = (bits | (next << available)) & mask;
+			bits = ShiftRight(next, width - available);
+			available += 64 - width;
+		}
+
+		keys[i] = static_cast<Key>(keys[i - 1] + delta);
+	}
+
+	return count;
+}
+
+} /* namespace RunCodec */
+
+} /* namespace ring */
@@ -0,0 +1,186 @@
+/*
+ * @file: Simd.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#include "Simd.h"
+
+#include <algorithm>
+
+#include <immintrin.h>
+
+namespace ring
+{
+
+namespace Simd
+{
+
+namespace
+{
+
+constexpr size_t AVX2_WIDTH = 8; ///< Count of 32-bit values in AVX2 register
+
+void MergeScalar(const uint32_t* left, size_t leftSize, const uint32_t* right, size_t rightSize, uint32_t* out)
+{
+	std::merge(left, left + leftSize, right, right + rightSize, out);
+}
+
+size_t CountNotGreaterScalar(const uint32_t* values, size_t size, uint32_t bound)
+{
+	size_t count = 0;
+	while (count < size && values[count] <= bound)
+	{
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * @brief Sort bitonic sequence of 8 values
+ *
+ * Compares and swaps values at distances 4, 2 and 1
+ */
+__attribute__((target("avx2")))
+inline __m256i BitonicSort8(__m256i values)
+{
+	auto swapped = _mm256_permute2x128_si256(values, values, 1);
+	values = _mm256_blend_epi32(_mm256_min_epu32(values, swapped), _mm256_max_epu32(values, swapped), 0xF0);
+
+	swapped = _mm256_shuffle_epi32(values, _MM_SHUFFLE(1, 0, 3, 2));
+	values = _mm256_blend_epi32(_mm256_min_epu32(values, swapped), _mm256_max_epu32(values, swapped), 0xCC);
+
+	swapped = _mm256_shuffle_epi32(values, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm256_blend_epi32(_mm256_min_epu32(values, swapped), _mm256_max_epu32(values, swapped), 0xAA);
+}
+
+/**
+ * @brief Merge two sorted vectors
+ *
+ * @param[in,out] lo - the first vector, receives 8 smallest values
+ * @param[in,out] hi - the second vector, receives 8 largest values
+ */
+__attribute__((target("avx2")))
+inline void BitonicMerge8(__m256i& lo, __m256i& hi)
+{
+	// The first vector followed by the reversed second one is a bitonic sequence
+	auto reversed = _mm256_permutevar8x32_epi32(hi, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+	auto min = _mm256_min_epu32(lo, reversed);
+	auto max = _mm256_max_epu32(lo, reversed);
+
+	lo = BitonicSort8(min);
+	hi = BitonicSort8(max);
+}
+
+__attribute__((target("avx2")))
+void MergeAvx2(const uint32_t* left, size_t leftSize, const uint32_t* right, size_t rightSize, uint32_t* out)
+{
+	if (leftSize < AVX2_WIDTH || rightSize < AVX2_WIDTH)
+	{
+		MergeScalar(left, leftSize, right, rightSize, out);
+		return;
+	}
+
+	auto leftEnd = left + leftSize;
+	auto rightEnd = right + rightSize;
+
+	auto lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(left));
+	auto hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right));
+	left += AVX2_WIDTH;
+	right += AVX2_WIDTH;
+
+	// Values kept in hi are not less than any of the values stored, so the next 8 values
+	// come from the array with the smaller head
+	for (;;)
+	{
+		BitonicMerge8(lo, hi);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), lo);
+		out += AVX2_WIDTH;
+
+		auto fromLeft = (left != leftEnd) && (right == rightEnd || *left <= *right);
+		auto& next = fromLeft ? left : right;
+		auto end = fromLeft ? leftEnd : rightEnd;
+
+		// The rest of the array is shorter than a vector
+		if (end - next < static_cast<ptrdiff_t>(AVX2_WIDTH))
+		{
+			break;
+		}
+
+		lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(next));
+		next += AVX2_WIDTH;
+	}
+
+	// Merge the last vector with the rest of both arrays
+	uint32_t tail[AVX2_WIDTH];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(tail), hi);
+
+	uint32_t merged[AVX2_WIDTH * 2];
+	auto shortIsLeft = (leftEnd - left) < (rightEnd - right);
+	auto shortBegin = shortIsLeft ? left : right;
+	auto shortEnd = shortIsLeft ? leftEnd : rightEnd;
+	auto longBegin = shortIsLeft ? right : left;
+	auto longEnd = shortIsLeft ? rightEnd : leftEnd;
+
+	auto mergedEnd = std::merge(tail, tail + AVX2_WIDTH, shortBegin, shortEnd, merged);
+	std::merge(merged, mergedEnd, longBegin, longEnd, out);
+}
+
+__attribute__((target("avx2")))
+size_t CountNotGreaterAvx2(const uint32_t* values, size_t size, uint32_t bound)
+{
+	auto bounds = _mm256_set1_epi32(static_cast<int>(bound));
+	size_t count = 0;
+
+	for (; count + AVX2_WIDTH <= size; count += AVX2_WIDTH)
+	{
+		// value <= bound if max(value, bound) == bound
+		auto vector = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + count));
+		auto mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(
+			_mm256_cmpeq_epi32(_mm256_max_epu32(vector, bounds), bounds))));
+
+		if (mask != 0xFF)
+		{
+			return count + __builtin_ctz(~mask);
+		}
+	}
+
+	return count + CountNotGreaterScalar(values + count, size - count, bound);
+}
+
+bool DetectAvx2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+}
+
+bool HasAvx2()
+{
+	static const bool hasAvx2 = DetectAvx2();
+	return hasAvx2;
+}
+
+void Merge(const uint32_t* left, size_t leftSize, const uint32_t* right, size_t rightSize, uint32_t* out)
+{
+	if (HasAvx2())
+	{
+		MergeAvx2(left, leftSize, right, rightSize, out);
+	}
+	else
+	{
+		MergeScalar(left, leftSize, right, rightSize, out);
+	}
+}
+
+size_t CountNotGreater(const uint32_t* values, size_t size, uint32_t bound)
+{
+	return HasAvx2() ? CountNotGreaterAvx2(values, size, bound) : CountNotGreaterScalar(values, size, bound);
+}
+
+} /* namespace Simd */
+
+} /* namespace ring */
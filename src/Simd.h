@@ -0,0 +1,51 @@
+/*
+ * @file: Simd.h
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ring
+{
+
+/**
+ * @brief Vectorized kernels for 32-bit unsigned values
+ *
+ * AVX2 versions are selected at runtime if the CPU supports them,
+ * scalar ones are used otherwise.
+ */
+namespace Simd
+{
+
+/**
+ * @brief Check if AVX2 kernels are used
+ */
+bool HasAvx2();
+
+/**
+ * @brief Merge two sorted arrays
+ *
+ * AVX2 version merges 8 values at a time by a bitonic merge network
+ *
+ * @param left, leftSize - left sorted array
+ * @param right, rightSize - right sorted array
+ * @param out - output buffer for leftSize + rightSize values, must not overlap inputs
+ */
+void Merge(const uint32_t* left, size_t leftSize, const uint32_t* right, size_t rightSize, uint32_t* out);
+
+/**
+ * @brief Count of the leading values of a sorted array not greater than bound
+ *
+ * @param values, size - sorted array
+ * @param bound - bound value
+ */
+size_t CountNotGreater(const uint32_t* values, size_t size, uint32_t bound);
+
+} /* namespace Simd */
+
+} /* namespace ring */
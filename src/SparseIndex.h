@@ -0,0 +1,188 @@
+/*
+ * @file: SparseIndex.h
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+namespace ring
+{
+
+constexpr auto SPARSE_INDEX_FILE_SUFFIX = ".idx"; ///< Sparse index of a sorted file is next to it, named with this suffix
+constexpr char SPARSE_INDEX_SIGNATURE[8] = { 'B', 'S', 'I', 'N', 'D', 'E', 'X', '1' };
+
+/**
+ * @brief Header of sparse index file of a sorted file
+ *
+ * Index file is the header followed by entries, all in native byte order.
+ * Entries are of every interval-th element from the first one, so an element of a key is found
+ * by a binary search of entries and a read of the elements between two of them.
+ */
+template <typename K>
+struct SparseIndexHeader
+{
+	char signature[8]; ///< @ref SPARSE_INDEX_SIGNATURE
+	uint64_t keySize; ///< Size of K
+	uint64_t elementSize; ///< Size of sorted values or records in bytes
+	uint64_t keyOffset; ///< Offset of the key in element
+	uint64_t interval; ///< Count of elements between entries
+	uint64_t count; ///< Count of elements in the sorted file
+	K min; ///< Key of the first element, 0 if there are none
+	K max; ///< Key of the last element, 0 if there are none
+};
+
+/**
+ * @brief Entry of sparse index
+ */
+template <typename K>
+struct SparseIndexEntry
+{
+	K key;
+	uint64_t offset; ///< Byte offset of the element in the sorted file
+};
+
+/**
+ * @brief Builder of sparse index of a sorted file written sequentially, of any key type
+ */
+class SparseIndexer
+{
+public:
+	virtual ~SparseIndexer() = default;
+
+	/**
+	 * @brief Index next block of the file
+	 */
+	virtual void Add(const char* data, size_t size) = 0;
+
+	/**
+	 * @brief Index file contents
+	 */
+	virtual std::vector<char> Contents() const = 0;
+};
+
+/**
+ * @brief Builder of sparse index of K keys
+ *
+ * Takes written blocks as they are, elements may span blocks. Only indexed elements and the last one
+ * are copied, so indexing costs next to nothing.
+ */
+template <typename K>
+class SparseIndexBuilder final: public SparseIndexer
+{
+public:
+	/**
+	 * @brief Constructor
+	 *
+	 * @param elementSize - size of element in bytes
+	 * @param keyOffset - offset of the key in element
+	 * @param interval - count of elements between index entries, not 0
+	 */
+	SparseIndexBuilder(size_t elementSize, size_t keyOffset, uint64_t interval)
+		: m_elementSize(elementSize)
+			, m_keyOffset(keyOffset)
+			, m_interval(interval)
+			, m_element(elementSize)
+			, m_last(elementSize)
+	{
+	}
+
+	void Add(const char* data, size_t size) override
+	{
+		auto end = m_size + size;
+
+		// The next indexed element may have started in one of the previous blocks
+		while (m_next < end)
+		{
+			auto from = std::max(m_next, m_size);
+			auto to = std::min(m_next + m_elementSize, end);
+
+			memcpy(m_element.data() + (from - m_next), data + (from - m_size), to - from);
+
+			if (to < m_next + m_elementSize)
+			{
+				break;
+			}
+
+			// Padding of entries is zeroed as well as of the header, see Contents
+			SparseIndexEntry<K> entry;
+			memset(&entry, 0, sizeof(entry));
+			entry.key = KeyOf(m_element.data());
+			entry.offset = m_next;
+			m_entries.push_back(entry);
+			m_next += m_interval * m_elementSize;
+		}
+
+		if (size >= m_elementSize)
+		{
+			memcpy(m_last.data(), data + size - m_elementSize, m_elementSize);
+		}
+		else
+		{
+			memmove(m_last.data(), m_last.data() + size, m_elementSize - size);
+			memcpy(m_last.data() + m_elementSize - size, data, size);
+		}
+
+		m_size = end;
+	}
+
+	/**
+	 * @brief Size of indexed part of the file in bytes
+	 */
+	uint64_t Size() const
+	{
+		return m_size;
+	}
+
+	std::vector<char> Contents() const override
+	{
+		// Padding is zeroed too, so that index of the same output is the same
+		SparseIndexHeader<K> header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.signature, SPARSE_INDEX_SIGNATURE, sizeof(header.signature));
+		header.keySize = sizeof(K);
+		header.elementSize = m_elementSize;
+		header.keyOffset = m_keyOffset;
+		header.interval = m_interval;
+		header.count = m_size / m_elementSize;
+
+		if (header.count)
+		{
+			header.min = m_entries.front().key;
+			header.max = KeyOf(m_last.data());
+		}
+
+		std::vector<char> contents(sizeof(header) + m_entries.size() * sizeof(SparseIndexEntry<K>));
+		memcpy(contents.data(), &header, sizeof(header));
+		memcpy(contents.data() + sizeof(header), m_entries.data(), m_entries.size() * sizeof(SparseIndexEntry<K>));
+
+		return contents;
+	}
+
+private:
+	K KeyOf(const char* element) const
+	{
+		K key;
+		memcpy(&key, element + m_keyOffset, sizeof(key));
+
+		return key;
+	}
+
+	const size_t m_elementSize;
+	const size_t m_keyOffset;
+	const uint64_t m_interval;
+	uint64_t m_size = 0; ///< Count of bytes indexed
+	uint64_t m_next = 0; ///< Offset of the next indexed element
+	std::vector<char> m_element; ///< The next indexed element, may be partial
+	std::vector<char> m_last; ///< The last element
+	std::vector<SparseIndexEntry<K>> m_entries;
+};
+
+} /* namespace ring */
@@ -0,0 +1,224 @@
+/*
+ * @file: ThreadPool.h
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace ring
+{
+
+/**
+ * @brief Work stealing thread pool
+ *
+ * Fixed count of worker threads, each with its own task queue.
+ * Tasks submitted from a worker go to its own queue, the rest are spread round-robin.
+ * An idle worker takes tasks from the back of its own queue first
+ * and steals from the front of the others.
+ */
+class ThreadPool
+{
+public:
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * @brief Worker thread initializer
+	 *
+	 * @param index - index of the worker thread
+	 */
+	using Initializer = std::function<void(size_t index)>;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param threadCount - count of worker threads. 0 - CPU core count
+	 * @param initializer - called by each worker thread before running tasks, e.g. to set its affinity
+	 */
+	explicit ThreadPool(size_t threadCount, Initializer initializer = nullptr)
+		: m_initializer(std::move(initializer))
+	{
+		if (!threadCount)
+		{
+			threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+
+		for (size_t i = 0; i < threadCount; i++)
+		{
+			m_workers.push_back(std::make_unique<Worker>());
+		}
+
+		for (size_t i = 0; i < threadCount; i++)
+		{
+			m_workers[i]->thread = std::thread(&ThreadPool::Run, this, i);
+		}
+	}
+
+	/**
+	 * @brief Destructor
+	 *
+	 * Completes all the submitted tasks and joins worker threads
+	 */
+	~ThreadPool() noexcept
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+
+		m_cond.notify_all();
+
+		for (auto& worker : m_workers)
+		{
+			worker->thread.join();
+		}
+	}
+
+	/**
+	 * @brief Count of worker threads
+	 */
+	size_t Size() const
+	{
+		return m_workers.size();
+	}
+
+	/**
+	 * @brief Count of submitted tasks not taken by a worker yet
+	 */
+	size_t PendingCount() const
+	{
+		return m_pending;
+	}
+
+	/**
+	 * @brief Submit task
+	 *
+	 * @param task - callable without arguments
+	 *
+	 * @return Future of the task result, holds an exception if the task throws
+	 */
+	template <typename F>
+	auto Submit(F&& task)
+	{
+		using Result = decltype(task());
+
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		auto future = packaged->get_future();
+
+		Push([packaged]() { (*packaged)(); });
+
+		return future;
+	}
+
+private:
+	using Task = std::function<void()>;
+
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		std::thread thread;
+	};
+
+	void Push(Task task)
+	{
+		auto index = (t_pool == this) ? t_index : m_next++ % m_workers.size();
+
+		// Counted before it is published, so that no worker takes the task before it is counted
+		{
+			std::unique_lock<std::mutex> lock(m_workers[index]->mutex);
+			m_pending++;
+			m_workers[index]->tasks.push_back(std::move(task));
+		}
+
+		// A waiter either sees the count or is already waiting when notified
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+		}
+
+		m_cond.notify_one();
+	}
+
+	bool Pop(size_t index, Task& task)
+	{
+		for (size_t i = 0; i < m_workers.size(); i++)
+		{
+			auto& worker = *m_workers[(index + i) % m_workers.size()];
+			std::unique_lock<std::mutex> lock(worker.mutex);
+
+			if (!worker.tasks.empty())
+			{
+				if (i)
+				{
+					task = std::move(worker.tasks.front());
+					worker.tasks.pop_front();
+				}
+				else
+				{
+					task = std::move(worker.tasks.back());
+					worker.tasks.pop_back();
+				}
+
+				m_pending--;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void Run(size_t index)
+	{
+		t_pool = this;
+		t_index = index;
+
+		if (m_initializer)
+		{
+			m_initializer(index);
+		}
+
+		for (;;)
+		{
+			Task task;
+
+			if (Pop(index, task))
+			{
+				task();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this]() { return m_stop || m_pending; });
+
+			if (m_stop && !m_pending)
+			{
+				return;
+			}
+		}
+	}
+
+	const Initializer m_initializer;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::atomic<size_t> m_next { 0 };
+	std::atomic<size_t> m_pending { 0 };
+	bool m_stop = false;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+
+	static inline thread_local ThreadPool* t_pool = nullptr; ///< Pool the current thread works for
+	static inline thread_local size_t t_index = 0; ///< Index of the current worker thread
+};
+
+} /* namespace ring */
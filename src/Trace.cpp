@@ -0,0 +1,94 @@
+/*
+ * @file: Trace.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#include "Trace.h"
+#include "BlobSort.h"
+
+#include <iomanip>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace ring
+{
+
+namespace
+{
+
+constexpr auto TRACE_PROCESS_ID = 1; ///< A trace is of a single sort, so of a single process
+constexpr auto TRACE_CATEGORY = "blobsort";
+
+uint32_t CurrentThread()
+{
+	thread_local const uint32_t thread = syscall(SYS_gettid);
+
+	return thread;
+}
+
+}
+
+Tracer::Tracer(const std::string& path)
+	: m_path(path)
+		, m_file(path)
+		, m_start(Clock::now())
+{
+	if (!m_file)
+	{
+		throw SortException("Failed to create trace " + m_path);
+	}
+}
+
+void Tracer::Add(const char* name, Clock::time_point start, Clock::time_point end, const Args& args)
+{
+	Span span { name, CurrentThread(), std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_start).count(),
+		std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), args };
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_spans.push_back(span);
+}
+
+void Tracer::Write()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Complete events, timestamps and durations are in microseconds
+	m_file << std::fixed << std::setprecision(3) << "{\"traceEvents\": [";
+
+	for (size_t i = 0; i < m_spans.size(); i++)
+	{
+		const auto& span = m_spans[i];
+
+		m_file << (i ? ",\n" : "\n")
+			<< "{\"name\": \"" << span.name << "\", \"cat\": \"" << TRACE_CATEGORY << "\", \"ph\": \"X\""
+			<< ", \"pid\": " << TRACE_PROCESS_ID << ", \"tid\": " << span.thread
+			<< ", \"ts\": " << span.start / 1e3 << ", \"dur\": " << span.duration / 1e3;
+
+		if (span.args.count)
+		{
+			m_file << ", \"args\": {";
+
+			for (size_t j = 0; j < span.args.count; j++)
+			{
+				m_file << (j ? ", \"" : "\"") << span.args.values[j].name << "\": " << span.args.values[j].value;
+			}
+
+			m_file << '}';
+		}
+
+		m_file << '}';
+	}
+
+	m_file << "\n], \"displayTimeUnit\": \"ms\"}\n";
+	m_file.close();
+
+	if (!m_file)
+	{
+		throw SortException("Failed to write trace " + m_path);
+	}
+}
+
+} /* namespace ring */
@@ -0,0 +1,116 @@
+/*
+ * @file: Trace.h
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <array>
+#include <initializer_list>
+#include <algorithm>
+#include <cstdint>
+
+namespace ring
+{
+
+/**
+ * @brief Recorder of spans of the threads of a sort
+ *
+ * Spans are kept in memory and written at once as Chrome trace event JSON, which chrome://tracing
+ * and Perfetto show as a timeline of each thread. Spans are of whole blocks, runs and merges,
+ * so they are few enough to be recorded under a lock.
+ */
+class Tracer
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Arg
+	{
+		const char* name; ///< A string literal
+		uint64_t value;
+	};
+
+	/**
+	 * @brief Named numbers shown with a span, such as offset and size of the block it is of
+	 *
+	 * Kept in place, so that spans of a timer cost no allocation until recorded
+	 */
+	struct Args
+	{
+		static constexpr size_t MAX_COUNT = 3;
+
+		Args(std::initializer_list<Arg> args = {})
+			: count(std::min(args.size(), MAX_COUNT))
+		{
+			std::copy_n(args.begin(), count, values.begin());
+		}
+
+		/**
+		 * @brief Add an arg known once the span is under way, ignored if there are too many
+		 */
+		void Add(const char* name, uint64_t value)
+		{
+			if (count < MAX_COUNT)
+			{
+				values[count++] = { name, value };
+			}
+		}
+
+		std::array<Arg, MAX_COUNT> values;
+		size_t count;
+	};
+
+	Tracer(const Tracer&) = delete;
+	Tracer& operator=(const Tracer&) = delete;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param path - path of trace file to write, timestamps are relative to construction
+	 *
+	 * @throw @ref ring::SortException if the file can't be created, so that a sort fails before it starts
+	 */
+	explicit Tracer(const std::string& path);
+
+	/**
+	 * @brief Record span of the calling thread
+	 *
+	 * @param name - span name, a string literal
+	 * @param start, end - span times
+	 * @param args - args of the span, written as its "args" object
+	 */
+	void Add(const char* name, Clock::time_point start, Clock::time_point end, const Args& args = {});
+
+	/**
+	 * @brief Write recorded spans to the trace file
+	 *
+	 * @throw @ref ring::SortException
+	 */
+	void Write();
+
+private:
+	struct Span
+	{
+		const char* name;
+		uint32_t thread; ///< Thread id as known to the kernel, as perf and top show it
+		int64_t start; ///< Nanoseconds since construction
+		int64_t duration; ///< Nanoseconds
+		Args args;
+	};
+
+	const std::string m_path;
+	std::ofstream m_file;
+	const Clock::time_point m_start;
+	std::mutex m_mutex;
+	std::vector<Span> m_spans;
+};
+
+} /* namespace ring */
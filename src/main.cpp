@@ -6,26 +6,573 @@
  */
 
 #include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <vector>
+
+#include <getopt.h>
 
 #include "BlobSort.h"
 
+namespace
+{
+
+enum LongOnlyOption
+{
+	OPTION_MMAP = 256, ///< Past any short option character
+	OPTION_PARALLEL_RUNS,
+	OPTION_IO,
+	OPTION_RECORD_SIZE,
+	OPTION_KEY_OFFSET,
+	OPTION_COMPRESS,
+	OPTION_STATS,
+	OPTION_HUGE_PAGES,
+	OPTION_NUMA,
+	OPTION_TEMP_PLACEMENT,
+	OPTION_COUNTING,
+	OPTION_ADAPTIVE,
+	OPTION_RESUME,
+	OPTION_LIMIT,
+	OPTION_RANGE,
+	OPTION_UNIQUE,
+	OPTION_COUNT,
+	OPTION_PARTITION,
+	OPTION_INDEX,
+	OPTION_DEVICE_STREAMS,
+	OPTION_BANDWIDTH,
+	OPTION_TRACE,
+};
+
+void PrintUsage()
+{
+	std::cerr << "Usage: blobsort [options] <in_file> <out_file>\n"
+		"       blobsort --partition [options] <in_file> <out_file>...\n"
+		"Options:\n"
+		"  -m, --memory=SIZE|auto   memory budget (default 256M), auto - a half of available RAM\n"
+		"  -c, --chunk-size=SIZE    sorted run size (default memory budget / pool depth)\n"
+		"  -p, --pool-depth=COUNT   count of memory chunks (default two per CPU core)\n"
+		"  -f, --fan-in=COUNT       max count of runs merged at once (default 64)\n"
+		"  -k, --kernel=radix|std   in-memory sort algorithm (default radix)\n"
+		"  -j, --threads=COUNT      count of worker threads (default CPU core count)\n"
+		"  -t, --type=TYPE          value type: u16, u32, u64, i16, i32, i64, f32 or f64 (default u32)\n"
+		"  -T, --temp-dir=PATH      directory of temp files, may be repeated (default system temp directory)\n"
+		"      --temp-placement=round-robin|free-space  placement of temp files among directories\n"
+		"                           (default round-robin)\n"
+		"      --mmap               memory-map input file\n"
+		"      --parallel-runs      sort each run using all the threads\n"
+		"      --io=buffered|direct|uring  file I/O backend (default buffered)\n"
+		"      --compress           compress temp run files\n"
+		"      --counting=off|auto|always  sort values by counting them in a single pass, auto - if sampled values\n"
+		"                           repeat or are of a dense range (default off)\n"
+		"      --adaptive           exploit presorted input\n"
+		"      --resume             keep temp files of a failed sort, resume a failed sort of the same input\n"
+		"      --limit=COUNT        output only COUNT smallest values, or records of the smallest keys\n"
+		"      --range=LO:HI        output only values or keys in [LO, HI), either bound may be omitted\n"
+		"      --unique             output each value once, or one record of each key\n"
+		"      --count              output each value once followed by its 64-bit count\n"
+		"      --index=COUNT        write sparse index of every COUNT-th output value or record to out_file.idx\n"
+		"      --partition          split input into out_files by ranges of values or keys, sorted separately,\n"
+		"                           they make shards of sorted input in the order of out_files\n"
+		"      --device-streams=COUNT  max count of concurrent reads and writes of each disk (default no limit)\n"
+		"      --bandwidth=RATE[@HH:MM-HH:MM]  max bytes read and written per second, in a window of local time\n"
+		"                           if given, may be repeated - the first window of the current time applies\n"
+		"      --huge-pages         back memory pool with huge pages\n"
+		"      --numa               split threads and memory between NUMA nodes\n"
+		"      --record-size=SIZE   sort fixed-size records by a key of the value type\n"
+		"      --key-offset=OFFSET  offset of the key in record (default 0)\n"
+		"      --stats              print statistics as JSON lines to stderr every second and on completion\n"
+		"      --trace=FILE         write timeline of each thread as Chrome trace event JSON to FILE\n"
+		"SIZE is a count of bytes with an optional K, M or G suffix\n"
+		"- as in_file reads standard input, as out_file writes standard output\n"
+		"tcp://:PORT as in_file accepts a connection, tcp://HOST:PORT as out_file connects to a host\n";
+}
+
+/**
+ * @brief Parse size argument
+ *
+ * @param[in] arg - size string, e.g. "512M"
+ * @param[out] size - parsed size
+ *
+ * @return true on success
+ */
+bool ParseSize(const char* arg, uintmax_t& size)
+{
+	char* end = nullptr;
+	size = strtoull(arg, &end, 10);
+
+	if (end == arg)
+	{
+		return false;
+	}
+
+	switch (*end)
+	{
+	case 'G': case 'g': size <<= 10; // fall through
+	case 'M': case 'm': size <<= 10; // fall through
+	case 'K': case 'k': size <<= 10; ++end; break;
+	default: break;
+	}
+
+	return *end == '\0';
+}
+
+bool ParseCount(const char* arg, unsigned& count)
+{
+	uintmax_t size = 0;
+
+	if (!ParseSize(arg, size) || size > std::numeric_limits<unsigned>::max())
+	{
+		return false;
+	}
+
+	count = size;
+	return true;
+}
+
+bool ParseKernel(const char* arg, ring::SortKernel& kernel)
+{
+	if (!strcmp(arg, "radix"))
+	{
+		kernel = ring::SortKernel::Radix;
+	}
+	else if (!strcmp(arg, "std"))
+	{
+		kernel = ring::SortKernel::Std;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool ParseIoBackend(const char* arg, ring::IoBackend& backend)
+{
+	if (!strcmp(arg, "buffered"))
+	{
+		backend = ring::IoBackend::Buffered;
+	}
+	else if (!strcmp(arg, "direct"))
+	{
+		backend = ring::IoBackend::Direct;
+	}
+	else if (!strcmp(arg, "uring"))
+	{
+		backend = ring::IoBackend::Uring;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Print statistics as a JSON line to stderr
+ */
+void PrintStats(const ring::SortStats& stats)
+{
+	std::ostringstream json;
+
+	json << std::fixed << std::setprecision(3)
+		<< "{\"phase\": \"" << (stats.phase == ring::SortPhase::RunGeneration ? "run_generation" : "merge") << '"'
+		<< ", \"done\": " << (stats.done ? "true" : "false")
+		<< ", \"elapsed_seconds\": " << stats.elapsedSeconds
+		<< ", \"phase_done\": " << stats.phaseDone
+		<< ", \"phase_total\": " << stats.phaseTotal
+		<< ", \"bytes_read\": " << stats.bytesRead
+		<< ", \"bytes_written\": " << stats.bytesWritten
+		<< ", \"run_count\": " << stats.runCount
+		<< ", \"merge_count\": " << stats.mergeCount
+		<< ", \"read_seconds\": " << stats.readSeconds
+		<< ", \"sort_seconds\": " << stats.sortSeconds
+		<< ", \"write_seconds\": " << stats.writeSeconds
+		<< ", \"merge_seconds\": " << stats.mergeSeconds
+		<< ", \"pool_wait_seconds\": " << stats.poolWaitSeconds
+		<< ", \"pool_available\": " << stats.poolAvailable
+		<< ", \"task_queue_depth\": " << stats.taskQueueDepth
+		<< ", \"read_queue_depth\": " << stats.readQueueDepth
+		<< ", \"write_queue_depth\": " << stats.writeQueueDepth
+		<< "}\n";
+
+	std::cerr << json.str() << std::flush;
+}
+
+bool ParseTempPlacement(const char* arg, ring::TempPlacement& placement)
+{
+	if (!strcmp(arg, "round-robin"))
+	{
+		placement = ring::TempPlacement::RoundRobin;
+	}
+	else if (!strcmp(arg, "free-space"))
+	{
+		placement = ring::TempPlacement::FreeSpace;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool ParseCounting(const char* arg, ring::CountingMode& mode)
+{
+	if (!strcmp(arg, "off"))
+	{
+		mode = ring::CountingMode::Off;
+	}
+	else if (!strcmp(arg, "auto"))
+	{
+		mode = ring::CountingMode::Auto;
+	}
+	else if (!strcmp(arg, "always"))
+	{
+		mode = ring::CountingMode::Always;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Parse range of values argument, e.g. "10:20" or ":20"
+ *
+ * Bounds are parsed as values by the sort
+ */
+bool ParseRange(const char* arg, std::string& low, std::string& high)
+{
+	auto separator = strchr(arg, ':');
+
+	if (!separator)
+	{
+		return false;
+	}
+
+	low.assign(arg, separator);
+	high = separator + 1;
+
+	return true;
+}
+
+/**
+ * @brief Parse minute of day argument, e.g. "09:30"
+ *
+ * @param[in] arg - time string
+ * @param[out] minute - minute of day
+ *
+ * @return Past the parsed time, nullptr on failure
+ */
+const char* ParseMinute(const char* arg, unsigned& minute)
+{
+	char* end = nullptr;
+	auto hours = strtoul(arg, &end, 10);
+
+	if (end == arg || *end != ':' || hours > 24)
+	{
+		return nullptr;
+	}
+
+	auto minutesBegin = end + 1;
+	auto minutes = strtoul(minutesBegin, &end, 10);
+
+	if (end == minutesBegin || minutes > 59 || hours * 60 + minutes > 24 * 60)
+	{
+		return nullptr;
+	}
+
+	minute = hours * 60 + minutes;
+	return end;
+}
+
+/**
+ * @brief Parse bandwidth limit argument, e.g. "50M" or "50M@09:00-18:00"
+ */
+bool ParseBandwidth(const char* arg, std::vector<ring::BandwidthLimit>& limits)
+{
+	ring::BandwidthLimit limit;
+	auto window = strchr(arg, '@');
+	std::string rate(arg, window ? window : arg + strlen(arg));
+
+	if (!ParseSize(rate.c_str(), limit.bytesPerSecond) || !limit.bytesPerSecond)
+	{
+		return false;
+	}
+
+	if (window)
+	{
+		auto end = ParseMinute(window + 1, limit.beginMinute);
+
+		if (!end || *end != '-' || limit.beginMinute == 24 * 60)
+		{
+			return false;
+		}
+
+		end = ParseMinute(end + 1, limit.endMinute);
+
+		if (!end || *end != '\0')
+		{
+			return false;
+		}
+	}
+
+	limits.push_back(limit);
+	return true;
+}
+
+using SortFunction = void (*)(const std::string&, const std::string&, const ring::SortOptions&);
+using PartitionFunction = void (*)(const std::string&, const std::vector<std::string>&, const ring::SortOptions&);
+
+/**
+ * @brief Functions of the value type
+ */
+struct TypeFunctions
+{
+	SortFunction sort = ring::SortBlob32;
+	PartitionFunction partition = ring::PartitionBlobT<uint32_t>;
+};
+
+bool ParseType(const char* arg, TypeFunctions& functions)
+{
+	const struct
+	{
+		const char* name;
+		TypeFunctions functions;
+	} types[] =
+	{
+		{ "u16", { ring::SortBlobT<uint16_t>, ring::PartitionBlobT<uint16_t> } },
+		{ "u32", { ring::SortBlobT<uint32_t>, ring::PartitionBlobT<uint32_t> } },
+		{ "u64", { ring::SortBlobT<uint64_t>, ring::PartitionBlobT<uint64_t> } },
+		{ "i16", { ring::SortBlobT<int16_t>, ring::PartitionBlobT<int16_t> } },
+		{ "i32", { ring::SortBlobT<int32_t>, ring::PartitionBlobT<int32_t> } },
+		{ "i64", { ring::SortBlobT<int64_t>, ring::PartitionBlobT<int64_t> } },
+		{ "f32", { ring::SortBlobT<float>, ring::PartitionBlobT<float> } },
+		{ "f64", { ring::SortBlobT<double>, ring::PartitionBlobT<double> } },
+	};
+
+	for (const auto& type : types)
+	{
+		if (!strcmp(arg, type.name))
+		{
+			functions = type.functions;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Parse command line options
+ *
+ * @return true on success
+ */
+bool ParseOptions(int argc, char* argv[], ring::SortOptions& options, TypeFunctions& functions, bool& partition)
+{
+	const option longOptions[] =
+	{
+		{ "memory", required_argument, nullptr, 'm' },
+		{ "chunk-size", required_argument, nullptr, 'c' },
+		{ "pool-depth", required_argument, nullptr, 'p' },
+		{ "fan-in", required_argument, nullptr, 'f' },
+		{ "kernel", required_argument, nullptr, 'k' },
+		{ "threads", required_argument, nullptr, 'j' },
+		{ "type", required_argument, nullptr, 't' },
+		{ "temp-dir", required_argument, nullptr, 'T' },
+		{ "temp-placement", required_argument, nullptr, OPTION_TEMP_PLACEMENT },
+		{ "mmap", no_argument, nullptr, OPTION_MMAP },
+		{ "parallel-runs", no_argument, nullptr, OPTION_PARALLEL_RUNS },
+		{ "io", required_argument, nullptr, OPTION_IO },
+		{ "compress", no_argument, nullptr, OPTION_COMPRESS },
+		{ "counting", required_argument, nullptr, OPTION_COUNTING },
+		{ "adaptive", no_argument, nullptr, OPTION_ADAPTIVE },
+		{ "resume", no_argument, nullptr, OPTION_RESUME },
+		{ "limit", required_argument, nullptr, OPTION_LIMIT },
+		{ "range", required_argument, nullptr, OPTION_RANGE },
+		{ "unique", no_argument, nullptr, OPTION_UNIQUE },
+		{ "count", no_argument, nullptr, OPTION_COUNT },
+		{ "index", required_argument, nullptr, OPTION_INDEX },
+		{ "device-streams", required_argument, nullptr, OPTION_DEVICE_STREAMS },
+		{ "bandwidth", required_argument, nullptr, OPTION_BANDWIDTH },
+		{ "partition", no_argument, nullptr, OPTION_PARTITION },
+		{ "huge-pages", no_argument, nullptr, OPTION_HUGE_PAGES },
+		{ "numa", no_argument, nullptr, OPTION_NUMA },
+		{ "record-size", required_argument, nullptr, OPTION_RECORD_SIZE },
+		{ "key-offset", required_argument, nullptr, OPTION_KEY_OFFSET },
+		{ "stats", no_argument, nullptr, OPTION_STATS },
+		{ "trace", required_argument, nullptr, OPTION_TRACE },
+		{ nullptr, 0, nullptr, 0 },
+	};
+
+	for (int opt; (opt = getopt_long(argc, argv, "m:c:p:f:k:j:t:T:", longOptions, nullptr)) != -1;)
+	{
+		bool ok = false;
+
+		switch (opt)
+		{
+		case 'm':
+			if (!strcmp(optarg, "auto"))
+			{
+				options.memoryBudget = 0;
+				ok = true;
+			}
+			else
+			{
+				ok = ParseSize(optarg, options.memoryBudget) && options.memoryBudget;
+			}
+			break;
+		case 'c':
+			ok = ParseSize(optarg, options.chunkSize);
+			break;
+		case 'p':
+			ok = ParseCount(optarg, options.poolDepth);
+			break;
+		case 'f':
+			ok = ParseCount(optarg, options.mergeFanIn);
+			break;
+		case 'k':
+			ok = ParseKernel(optarg, options.sortKernel);
+			break;
+		case 'j':
+			ok = ParseCount(optarg, options.threadCount);
+			break;
+		case 't':
+			ok = ParseType(optarg, functions);
+			break;
+		case 'T':
+			options.tempDirectories.push_back(optarg);
+			ok = true;
+			break;
+		case OPTION_TEMP_PLACEMENT:
+			ok = ParseTempPlacement(optarg, options.tempPlacement);
+			break;
+		case OPTION_MMAP:
+			options.mapInput = ok = true;
+			break;
+		case OPTION_PARALLEL_RUNS:
+			options.parallelRuns = ok = true;
+			break;
+		case OPTION_IO:
+			ok = ParseIoBackend(optarg, options.ioBackend);
+			break;
+		case OPTION_COMPRESS:
+			options.compressRuns = ok = true;
+			break;
+		case OPTION_COUNTING:
+			ok = ParseCounting(optarg, options.counting);
+			break;
+		case OPTION_ADAPTIVE:
+			options.adaptive = ok = true;
+			break;
+		case OPTION_RESUME:
+			options.resume = ok = true;
+			break;
+		case OPTION_LIMIT:
+			ok = ParseSize(optarg, options.limit) && options.limit;
+			break;
+		case OPTION_RANGE:
+			ok = ParseRange(optarg, options.rangeLow, options.rangeHigh);
+			break;
+		case OPTION_UNIQUE:
+			options.duplicates = ring::DuplicateMode::Unique;
+			ok = true;
+			break;
+		case OPTION_COUNT:
+			options.duplicates = ring::DuplicateMode::Count;
+			ok = true;
+			break;
+		case OPTION_INDEX:
+			ok = ParseSize(optarg, options.indexInterval) && options.indexInterval;
+			break;
+		case OPTION_DEVICE_STREAMS:
+			ok = ParseCount(optarg, options.deviceStreams);
+			break;
+		case OPTION_BANDWIDTH:
+			ok = ParseBandwidth(optarg, options.bandwidthLimits);
+			break;
+		case OPTION_PARTITION:
+			partition = ok = true;
+			break;
+		case OPTION_HUGE_PAGES:
+			options.hugePages = ok = true;
+			break;
+		case OPTION_NUMA:
+			options.numa = ok = true;
+			break;
+		case OPTION_RECORD_SIZE:
+			ok = ParseSize(optarg, options.recordSize);
+			break;
+		case OPTION_KEY_OFFSET:
+			ok = ParseSize(optarg, options.keyOffset);
+			break;
+		case OPTION_STATS:
+			options.statsCallback = PrintStats;
+			ok = true;
+			break;
+		case OPTION_TRACE:
+			options.traceFile = optarg;
+			ok = true;
+			break;
+		default:
+			break;
+		}
+
+		if (!ok)
+		{
+			return false;
+		}
+	}
+
+	return partition ? argc - optind >= 2 : argc - optind == 2;
+}
+
+}
+
 int main(int argc, char* argv[])
 {
-	if (argc != 3)
+	ring::SortOptions options;
+	TypeFunctions functions;
+	bool partition = false;
+
+	if (!ParseOptions(argc, argv, options, functions, partition))
 	{
-		std::cerr << "Usage: blobsort <in_file> <out_file>\n";
+		PrintUsage();
 		return EXIT_FAILURE;
 	}
 
+	std::vector<std::string> outFilePaths(argv + optind + 1, argv + argc);
+
+	// Keep messages out of sorted values written to standard output
+	auto toStdout = std::find(outFilePaths.cbegin(), outFilePaths.cend(), "-") != outFilePaths.cend();
+	auto& log = toStdout ? std::cerr : std::cout;
+
 	try
 	{
 		std::ios_base::sync_with_stdio(false);
-		ring::SortBlob32(argv[1], argv[2]);
-		std::cout << "Finished\n";
+
+		if (partition)
+		{
+			functions.partition(argv[optind], outFilePaths, options);
+		}
+		else
+		{
+			functions.sort(argv[optind], outFilePaths.front(), options);
+		}
+
+		log << "Finished\n";
 	}
 	catch (const ring::SortException& e)
 	{
-		std::cout << e.what() << std::endl;
+		log << e.what() << std::endl;
+		return EXIT_FAILURE;
 	}
 
 	return EXIT_SUCCESS;
@@ -0,0 +1,205 @@
+/*
+ * @file: DuplicatesTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+/*
+ * Tests of the unique and counted outputs
+ *
+ * Counted output of random values is expanded back by the counts and compared to the sorted input,
+ * so that no value is lost or counted twice when equal values meet across runs and merges.
+ * Unique output is compared to the distinct sorted values, with and without a limit of them.
+ * Values are of few distinct ones, of many and of a single one, sorted in memory and through merged runs.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#include "BlobSort.h"
+
+using namespace ring;
+
+namespace
+{
+
+constexpr auto SEED = 20261014;
+constexpr size_t VALUE_COUNT = 1 << 19;
+constexpr uintmax_t SMALL_MEMORY_BUDGET = 1 << 20; ///< Input of a few MB is sorted by merged runs within it
+
+unsigned g_failures = 0;
+
+void Check(bool passed, const std::string& message, uint64_t distinctCount, const SortOptions& options)
+{
+	if (!passed)
+	{
+		std::cerr << "FAILED: " << message << ", " << distinctCount << " distinct values, limit " << options.limit
+			<< ", memory budget " << options.memoryBudget << '\n';
+		g_failures++;
+	}
+}
+
+class VectorSource: public SortSource
+{
+public:
+	explicit VectorSource(const std::vector<char>& data)
+		: m_data(data)
+	{
+	}
+
+	size_t Read(void* buffer, size_t size) override
+	{
+		size = std::min(size, m_data.size() - m_position);
+		memcpy(buffer, m_data.data() + m_position, size);
+		m_position += size;
+
+		return size;
+	}
+
+private:
+	const std::vector<char>& m_data;
+	size_t m_position = 0;
+};
+
+class VectorSink: public SortSink
+{
+public:
+	void Write(const void* data, size_t size) override
+	{
+		m_data.insert(m_data.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+	}
+
+	const std::vector<char>& Data() const
+	{
+		return m_data;
+	}
+
+private:
+	std::vector<char> m_data;
+};
+
+/**
+ * @brief Sort to counted output and expand it by the counts
+ *
+ * @return Expanded values, empty if the output is malformed
+ */
+template <typename T>
+std::vector<T> SortCounted(const std::vector<T>& values, SortOptions options, uint64_t distinctCount)
+{
+	constexpr size_t ELEMENT_SIZE = sizeof(T) + sizeof(uint64_t);
+
+	std::vector<char> input(values.size() * sizeof(T));
+	memcpy(input.data(), values.data(), input.size());
+
+	VectorSource source(input);
+	VectorSink sink;
+	options.duplicates = DuplicateMode::Count;
+	SortBlobT<T>(source, sink, options);
+
+	const auto& output = sink.Data();
+	Check(output.size() == distinctCount * ELEMENT_SIZE, "counted output size", distinctCount, options);
+
+	std::vector<T> expanded;
+	for (size_t offset = 0; offset + ELEMENT_SIZE <= output.size(); offset += ELEMENT_SIZE)
+	{
+		T value;
+		uint64_t count;
+		memcpy(&value, output.data() + offset, sizeof(value));
+		memcpy(&count, output.data() + offset + sizeof(value), sizeof(count));
+
+		Check(count > 0, "zero count", distinctCount, options);
+		Check(expanded.empty() || expanded.back() < value, "counted values not ascending", distinctCount, options);
+
+		expanded.insert(expanded.end(), count, value);
+	}
+
+	return expanded;
+}
+
+template <typename T>
+std::vector<T> SortUnique(const std::vector<T>& values, SortOptions options)
+{
+	std::vector<T> sorted;
+	options.duplicates = DuplicateMode::Unique;
+	SortBlobT<T>(values.data(), values.size(), [&](const T* data, size_t count)
+	{	sorted.insert(sorted.end(), data, data + count);}, options);
+
+	return sorted;
+}
+
+/**
+ * @brief Test counted and unique outputs of values of distinct count ones
+ */
+template <typename T>
+void TestValues(std::mt19937_64& random, uint64_t distinctCount)
+{
+	std::vector<T> values(VALUE_COUNT);
+	for (auto& value : values)
+	{
+		value = static_cast<T>(random() % distinctCount * 7);
+	}
+
+	auto sorted = values;
+	std::sort(sorted.begin(), sorted.end());
+
+	auto unique = sorted;
+	unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+	for (auto memoryBudget : { SortOptions().memoryBudget, SMALL_MEMORY_BUDGET })
+	{
+		SortOptions options;
+		options.memoryBudget = memoryBudget;
+
+		Check(SortCounted(values, options, unique.size()) == sorted, "expanded counted values", unique.size(),
+			options);
+		Check(SortUnique(values, options) == unique, "unique values", unique.size(), options);
+
+		// The limit counts distinct values
+		for (auto limit : { uintmax_t(1), uintmax_t(unique.size() / 2 + 1), uintmax_t(unique.size() + 1) })
+		{
+			options.limit = limit;
+
+			auto expected = unique;
+			expected.resize(std::min<size_t>(limit, unique.size()));
+			Check(SortUnique(values, options) == expected, "limited unique values", unique.size(), options);
+
+			auto counted = SortCounted(values, options, expected.size());
+			Check(counted == std::vector<T>(sorted.cbegin(), std::upper_bound(sorted.cbegin(), sorted.cend(),
+				expected.back())), "limited expanded counted values", unique.size(), options);
+		}
+	}
+}
+
+}
+
+int main()
+{
+	std::mt19937_64 random(SEED);
+
+	try
+	{
+		TestValues<uint32_t>(random, 1);
+		TestValues<uint32_t>(random, 10);
+		TestValues<uint64_t>(random, 100000);
+		TestValues<int16_t>(random, 5000);
+		TestValues<double>(random, 1000);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "FAILED: " << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	if (g_failures)
+	{
+		std::cerr << g_failures << " checks failed\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/*
+ * @file: HistogramTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+/*
+ * Tests of the key counts of the counting sort
+ *
+ * Counts of random keys are compared to the counts of a map, for histograms of a window only,
+ * of a hash table only and of both, with keys below, within and above the window. A hash table
+ * filled up to a half must refuse a new key and count the known ones still.
+ */
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <random>
+#include <limits>
+#include <cstdlib>
+
+#include "Histogram.h"
+
+using namespace ring;
+
+namespace
+{
+
+constexpr auto SEED = 20261014;
+constexpr size_t KEY_COUNT = 100000;
+
+unsigned g_failures = 0;
+
+void Check(bool passed, const std::string& message, size_t windowSize, size_t hashCapacity)
+{
+	if (!passed)
+	{
+		std::cerr << "FAILED: " << message << ", window of " << windowSize << " keys, hash table of "
+			<< hashCapacity << " entries\n";
+		g_failures++;
+	}
+}
+
+/**
+ * @brief Count keys by histogram and by map, and compare the counts in ascending order
+ */
+template <typename Key>
+void TestCounts(const std::vector<Key>& keys, Key low, size_t windowSize, size_t hashCapacity)
+{
+	KeyHistogram<Key> histogram(low, windowSize, hashCapacity);
+	std::map<Key, uint64_t> expected;
+	bool added = true;
+
+	for (auto key : keys)
+	{
+		added = histogram.Add(key) && added;
+		expected[key]++;
+	}
+
+	Check(added, "key not counted", windowSize, hashCapacity);
+
+	std::vector<std::pair<Key, uint64_t>> counts;
+	histogram.ForEach([&](Key key, uint64_t count) { counts.emplace_back(key, count); });
+
+	Check(counts == std::vector<std::pair<Key, uint64_t>>(expected.cbegin(), expected.cend()), "counts", windowSize,
+		hashCapacity);
+}
+
+/**
+ * @brief Keys of a dense range around low, and a few sparse ones of the whole key space
+ */
+template <typename Key>
+std::vector<Key> Keys(std::mt19937_64& random, Key low, size_t range, size_t sparseCount)
+{
+	std::vector<Key> keys;
+
+	for (size_t i = 0; i < KEY_COUNT; i++)
+	{
+		keys.push_back(static_cast<Key>(low - range / 2 + random() % range));
+	}
+
+	for (size_t i = 0; i < sparseCount; i++)
+	{
+		keys.push_back(static_cast<Key>(random()));
+	}
+
+	keys.push_back(std::numeric_limits<Key>::min());
+	keys.push_back(std::numeric_limits<Key>::max());
+
+	return keys;
+}
+
+template <typename Key>
+void TestType(std::mt19937_64& random)
+{
+	// The window must not wrap around the key space
+	Key low = static_cast<Key>(1000 + random() % (std::numeric_limits<Key>::max() - 2000));
+	auto keys = Keys<Key>(random, low, 1000, 100);
+
+	// Keys of the window are the dense range but its lower half, the rest are hashed
+	TestCounts(keys, low, 1000, 2048);
+	TestCounts(keys, low, 0, 4096);
+
+	// Only the key space limits are hashed
+	TestCounts(Keys<Key>(random, low, 1000, 0), static_cast<Key>(low - 500), 1000, 8);
+}
+
+/**
+ * @brief Window of the whole key space, ending at its last key
+ */
+void TestFullWindow(std::mt19937_64& random)
+{
+	std::vector<uint16_t> keys;
+	for (size_t i = 0; i < KEY_COUNT; i++)
+	{
+		keys.push_back(static_cast<uint16_t>(random()));
+	}
+
+	keys.push_back(0);
+	keys.push_back(std::numeric_limits<uint16_t>::max());
+
+	TestCounts<uint16_t>(keys, 0, size_t(1) << 16, 0);
+}
+
+void TestFullHash()
+{
+	constexpr size_t CAPACITY = 16;
+	KeyHistogram<uint32_t> histogram(0, 10, CAPACITY);
+
+	for (uint32_t key = 100; key < 100 + CAPACITY / 2; key++)
+	{
+		Check(histogram.Add(key), "key of a half full hash table", 10, CAPACITY);
+	}
+
+	Check(!histogram.Add(1000), "new key of a full hash table", 10, CAPACITY);
+	Check(histogram.Add(100), "known key of a full hash table", 10, CAPACITY);
+	Check(histogram.Add(5), "key of the window with a full hash table", 10, CAPACITY);
+	Check(!KeyHistogram<uint32_t>(0, 10, 0).Add(10), "key above the window with no hash table", 10, 0);
+
+	uint64_t total = 0;
+	histogram.ForEach([&](uint32_t, uint64_t count) { total += count; });
+	Check(total == CAPACITY / 2 + 2, "count of keys of a full hash table", 10, CAPACITY);
+}
+
+}
+
+int main()
+{
+	std::mt19937_64 random(SEED);
+
+	TestType<uint16_t>(random);
+	TestType<uint32_t>(random);
+	TestType<uint64_t>(random);
+	TestFullWindow(random);
+	TestFullHash();
+
+	if (g_failures)
+	{
+		std::cerr << g_failures << " checks failed\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+/*
+ * @file: RunCodecTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+/*
+ * Round trip tests of the sorted run codec
+ *
+ * Each frame is decoded from a copy placed at the end of a buffer of exactly its size plus
+ * DECODE_PADDING bytes of garbage, so that the decoder may use the padding but not rely on its contents.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+
+#include "RunCodec.h"
+
+using namespace ring;
+
+namespace
+{
+
+constexpr auto SEED = 20261014;
+constexpr unsigned RANDOM_FRAME_COUNT = 2000;
+
+unsigned g_failures = 0;
+
+template <typename Key>
+void Check(bool passed, const std::string& message, const std::vector<Key>& keys)
+{
+	if (!passed)
+	{
+		std::cerr << "FAILED: " << message << ", " << keys.size() << " keys of " << sizeof(Key) * 8 << " bits\n";
+		g_failures++;
+	}
+}
+
+/**
+ * @brief Encode and decode a frame
+ *
+ * @param keys - sorted keys, 1 to @ref RunCodec::FRAME_KEY_COUNT
+ * @param width - expected bit width of deltas
+ */
+template <typename Key>
+void RoundTrip(const std::vector<Key>& keys, unsigned width)
+{
+	std::vector<char> encoded(RunCodec::MaxFrameSize<Key>(), 0);
+	auto size = RunCodec::EncodeFrame(keys.data(), keys.size(), encoded.data());
+
+	Check(size <= RunCodec::MaxFrameSize<Key>(), "frame size over the max", keys);
+	Check(size == RunCodec::HeaderSize<Key>() + RunCodec::PayloadSize<Key>(encoded.data()), "frame size", keys);
+	Check(static_cast<uint8_t>(encoded[1]) == width, "delta width", keys);
+
+	std::vector<char> frame(size + RunCodec::DECODE_PADDING, '\xA5');
+	std::copy(encoded.begin(), encoded.begin() + size, frame.begin());
+
+	std::vector<Key> decoded(RunCodec::FRAME_KEY_COUNT);
+	auto count = RunCodec::DecodeFrame(frame.data(), decoded.data());
+	decoded.resize(count);
+
+	Check(count == keys.size(), "decoded key count", keys);
+	Check(decoded == keys, "decoded keys", keys);
+}
+
+template <typename Key>
+void TestSingleKey()
+{
+	RoundTrip(std::vector<Key> { 0 }, 0);
+	RoundTrip(std::vector<Key> { 12345 }, 0);
+	RoundTrip(std::vector<Key> { std::numeric_limits<Key>::max() }, 0);
+}
+
+template <typename Key>
+void TestEqualKeys()
+{
+	for (auto count : { size_t(2), size_t(63), RunCodec::FRAME_KEY_COUNT })
+	{
+		RoundTrip(std::vector<Key>(count, 777), 0);
+	}
+}
+
+/**
+ * @brief Frames of small deltas and a single delta of 63 or 64 bits at each position
+ */
+void TestWideDeltas()
+{
+	for (auto width : { 63u, 64u })
+	{
+		uint64_t jump = (width == 64) ? uint64_t(1) << 63 : (uint64_t(1) << 62) + 12345;
+
+		for (size_t position = 1; position < RunCodec::FRAME_KEY_COUNT; position += 9)
+		{
+			std::vector<uint64_t> keys(RunCodec::FRAME_KEY_COUNT);
+			for (size_t i = 1; i < keys.size(); i++)
+			{
+				keys[i] = keys[i - 1] + ((i == position) ? jump : i % 5);
+			}
+
+			RoundTrip(keys, width);
+		}
+
+		RoundTrip(std::vector<uint64_t> { 0, jump }, width);
+	}
+
+	RoundTrip(std::vector<uint64_t> { 0, std::numeric_limits<uint64_t>::max() }, 64);
+	RoundTrip(std::vector<uint64_t> { 1, std::numeric_limits<uint64_t>::max() }, 64);
+	RoundTrip(std::vector<uint64_t> { 0, std::numeric_limits<uint64_t>::max() >> 1 }, 63);
+}
+
+/**
+ * @brief Frames of every width of random deltas
+ */
+template <typename Key>
+void TestRandom(std::mt19937_64& random)
+{
+	constexpr unsigned KEY_BITS = sizeof(Key) * 8;
+
+	for (unsigned i = 0; i < RANDOM_FRAME_COUNT; i++)
+	{
+		size_t count = 1 + random() % RunCodec::FRAME_KEY_COUNT;
+		unsigned bits = random() % (KEY_BITS + 1);
+
+		std::vector<Key> keys(count);
+		for (auto& key : keys)
+		{
+			key = static_cast<Key>(bits ? random() >> (64 - bits) : 0);
+		}
+		std::sort(keys.begin(), keys.end());
+
+		unsigned width = 0;
+		for (size_t j = 1; j < count; j++)
+		{
+			uint64_t delta = keys[j] - keys[j - 1];
+			width = std::max<unsigned>(width, delta ? 64 - __builtin_clzll(delta) : 0);
+		}
+
+		RoundTrip(keys, width);
+	}
+}
+
+}
+
+int main()
+{
+	std::mt19937_64 random(SEED);
+
+	TestSingleKey<uint32_t>();
+	TestSingleKey<uint64_t>();
+	TestEqualKeys<uint32_t>();
+	TestEqualKeys<uint64_t>();
+	TestWideDeltas();
+	TestRandom<uint16_t>(random);
+	TestRandom<uint32_t>(random);
+	TestRandom<uint64_t>(random);
+
+	if (g_failures)
+	{
+		std::cerr << g_failures << " checks failed\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
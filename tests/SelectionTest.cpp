@@ -0,0 +1,203 @@
+/*
+ * @file: SelectionTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+/*
+ * Tests of the top-K limit and the value range selection
+ *
+ * Random values with many duplicates are sorted with bounds at, just below and just above
+ * the values of the input, of unsigned, signed and floating point values, with limits
+ * below and above the count of selected values. Each selection is tested in memory and
+ * through merged runs, and is compared to a filter of the sorted input.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+
+#include "BlobSort.h"
+
+using namespace ring;
+
+namespace
+{
+
+constexpr auto SEED = 20261014;
+constexpr size_t VALUE_COUNT = 1 << 19;
+constexpr int VALUE_RANGE = 1000; ///< Values are of [min, VALUE_RANGE), so each repeats
+constexpr uintmax_t SMALL_MEMORY_BUDGET = 1 << 20; ///< Input of a few MB is sorted by merged runs within it
+
+unsigned g_failures = 0;
+
+void Check(bool passed, const std::string& message, const SortOptions& options)
+{
+	if (!passed)
+	{
+		std::cerr << "FAILED: " << message << ", range [" << options.rangeLow << ", " << options.rangeHigh
+			<< "), limit " << options.limit << ", memory budget " << options.memoryBudget << '\n';
+		g_failures++;
+	}
+}
+
+template <typename T>
+std::vector<T> Sort(const std::vector<T>& values, const SortOptions& options)
+{
+	std::vector<T> sorted;
+	SortBlobT<T>(values.data(), values.size(), [&](const T* data, size_t count)
+	{	sorted.insert(sorted.end(), data, data + count);}, options);
+
+	return sorted;
+}
+
+/**
+ * @brief Sort with selection options and compare to sorted values of the range, up to the limit
+ *
+ * @param low, high - bounds of the range, empty - none
+ */
+template <typename T>
+void TestSelection(const std::vector<T>& values, const std::vector<T>& sorted, const std::string& low,
+	const std::string& high, uintmax_t limit)
+{
+	std::vector<T> expected;
+	for (auto value : sorted)
+	{
+		if ((low.empty() || value >= static_cast<T>(std::stod(low))) &&
+			(high.empty() || value < static_cast<T>(std::stod(high))))
+		{
+			expected.push_back(value);
+		}
+	}
+
+	if (limit && expected.size() > limit)
+	{
+		expected.resize(limit);
+	}
+
+	SortOptions options;
+	options.rangeLow = low;
+	options.rangeHigh = high;
+	options.limit = limit;
+	Check(Sort(values, options) == expected, "selected values", options);
+
+	options.memoryBudget = SMALL_MEMORY_BUDGET;
+	Check(Sort(values, options) == expected, "selected values", options);
+}
+
+template <typename T>
+std::vector<T> Values(std::mt19937_64& random, int min)
+{
+	std::vector<T> values(VALUE_COUNT);
+	for (auto& value : values)
+	{
+		value = static_cast<T>(min + static_cast<int>(random() % (VALUE_RANGE - min)));
+	}
+
+	return values;
+}
+
+/**
+ * @brief Selections of integers, bounds are values of the input or next to them
+ *
+ * @param min - the least value
+ */
+template <typename T>
+void TestIntegers(std::mt19937_64& random, int min)
+{
+	auto values = Values<T>(random, min);
+	auto sorted = values;
+	std::sort(sorted.begin(), sorted.end());
+
+	auto low = std::to_string(min + 100);
+	auto lowAbove = std::to_string(min + 101);
+	auto high = std::to_string(VALUE_RANGE - 100);
+	auto highBelow = std::to_string(VALUE_RANGE - 101);
+
+	std::vector<std::pair<std::string, std::string>> ranges { { low, high }, { lowAbove, highBelow }, { low, "" },
+		{ "", high }, { low, low }, { std::to_string(min), std::to_string(VALUE_RANGE) },
+		{ std::to_string(VALUE_RANGE), "" } };
+
+	for (const auto& bounds : ranges)
+	{
+		TestSelection(values, sorted, bounds.first, bounds.second, 0);
+		TestSelection(values, sorted, bounds.first, bounds.second, 1);
+		TestSelection(values, sorted, bounds.first, bounds.second, 1000);
+	}
+
+	// Limits of all the values and above the count of them
+	TestSelection(values, sorted, "", "", VALUE_COUNT);
+	TestSelection(values, sorted, "", "", VALUE_COUNT + 1);
+	TestSelection(values, sorted, low, high, VALUE_COUNT * 2);
+}
+
+void TestFloats(std::mt19937_64& random)
+{
+	std::vector<double> values;
+	for (auto value : Values<int32_t>(random, -VALUE_RANGE))
+	{
+		values.push_back(value / 4.0);
+	}
+
+	auto sorted = values;
+	std::sort(sorted.begin(), sorted.end());
+
+	TestSelection(values, sorted, "-10.25", "10.25", 0);
+	TestSelection(values, sorted, "-10.2", "10.3", 0);
+	TestSelection(values, sorted, "-0", "0.5", 100);
+	TestSelection(values, sorted, "", "-200", VALUE_COUNT + 1);
+}
+
+void TestInvalidBounds()
+{
+	std::vector<uint32_t> values { 3, 1, 2 };
+
+	for (const auto& bound : { "x", "-1", "1.5", "4294967296" })
+	{
+		SortOptions options;
+		options.rangeLow = bound;
+
+		try
+		{
+			Sort(values, options);
+			Check(false, "invalid bound accepted", options);
+		}
+		catch (const SortException&)
+		{
+		}
+	}
+}
+
+}
+
+int main()
+{
+	std::mt19937_64 random(SEED);
+
+	try
+	{
+		TestIntegers<uint16_t>(random, 0);
+		TestIntegers<uint32_t>(random, 0);
+		TestIntegers<int32_t>(random, -VALUE_RANGE);
+		TestIntegers<int64_t>(random, -VALUE_RANGE);
+		TestFloats(random);
+		TestInvalidBounds();
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "FAILED: " << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	if (g_failures)
+	{
+		std::cerr << g_failures << " checks failed\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+/*
+ * @file: SimdTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+/*
+ * Comparison tests of the vectorized kernels to the standard algorithms
+ *
+ * Covers every pair of sizes below a few vectors, so that tails shorter than a vector are merged
+ * from either side, and random sizes of values with many duplicates, of the full range
+ * and with the sign bit set, which a signed vector compare would get wrong.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+#include "Simd.h"
+
+using namespace ring;
+
+namespace
+{
+
+constexpr auto SEED = 20261014;
+constexpr size_t SMALL_SIZE = 40; ///< Sizes up to 5 vectors of 8 values are all tested
+constexpr unsigned RANDOM_CASE_COUNT = 2000;
+constexpr size_t RANDOM_MAX_SIZE = 5000;
+
+unsigned g_failures = 0;
+
+void Check(bool passed, const std::string& message, size_t leftSize, size_t rightSize)
+{
+	if (!passed)
+	{
+		std::cerr << "FAILED: " << message << ", sizes " << leftSize << " and " << rightSize << '\n';
+		g_failures++;
+	}
+}
+
+/**
+ * @brief Sorted values of a random kind
+ */
+std::vector<uint32_t> SortedValues(std::mt19937& random, size_t size, unsigned kind)
+{
+	std::vector<uint32_t> values(size);
+
+	for (auto& value : values)
+	{
+		switch (kind % 4)
+		{
+		case 0:
+			value = random() % 4; // Mostly duplicates
+			break;
+		case 1:
+			value = random(); // Full range
+			break;
+		case 2:
+			value = 0x80000000u | (random() % 1000); // Sign bit set
+			break;
+		default:
+			value = random() % 1000;
+			break;
+		}
+	}
+
+	std::sort(values.begin(), values.end());
+
+	return values;
+}
+
+void Compare(const std::vector<uint32_t>& left, const std::vector<uint32_t>& right, std::mt19937& random)
+{
+	std::vector<uint32_t> merged(left.size() + right.size());
+	std::vector<uint32_t> expected(merged.size());
+
+	Simd::Merge(left.data(), left.size(), right.data(), right.size(), merged.data());
+	std::merge(left.begin(), left.end(), right.begin(), right.end(), expected.begin());
+	Check(merged == expected, "Merge", left.size(), right.size());
+
+	// Bounds of the values present, between them and past both ends
+	std::vector<uint32_t> bounds { 0, 0xFFFFFFFFu, 0x7FFFFFFFu, 0x80000000u, static_cast<uint32_t>(random()) };
+	if (!left.empty())
+	{
+		bounds.push_back(left[random() % left.size()]);
+		bounds.push_back(left.front() - 1);
+		bounds.push_back(left.back());
+	}
+
+	for (auto bound : bounds)
+	{
+		auto count = Simd::CountNotGreater(left.data(), left.size(), bound);
+		auto expectedCount = std::upper_bound(left.begin(), left.end(), bound) - left.begin();
+		Check(count == static_cast<size_t>(expectedCount), "CountNotGreater", left.size(), right.size());
+	}
+}
+
+}
+
+int main()
+{
+	std::mt19937 random(SEED);
+
+	for (size_t leftSize = 0; leftSize <= SMALL_SIZE; leftSize++)
+	{
+		for (size_t rightSize = 0; rightSize <= SMALL_SIZE; rightSize++)
+		{
+			auto kind = leftSize + rightSize;
+			Compare(SortedValues(random, leftSize, kind), SortedValues(random, rightSize, kind), random);
+		}
+	}
+
+	for (unsigned i = 0; i < RANDOM_CASE_COUNT; i++)
+	{
+		auto leftSize = random() % RANDOM_MAX_SIZE;
+		auto rightSize = random() % RANDOM_MAX_SIZE;
+		Compare(SortedValues(random, leftSize, i), SortedValues(random, rightSize, i), random);
+	}
+
+	std::cout << "AVX2 kernels " << (Simd::HasAvx2() ? "tested" : "not supported, scalar kernels tested") << '\n';
+
+	if (g_failures)
+	{
+		std::cerr << g_failures << " checks failed\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,288 @@
+/*
+ * @file: SparseIndexTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+/*
+ * Tests of the sparse index of sorted output
+ *
+ * Files of values and records are sorted with an index, in memory, through merged runs, compressed
+ * and to counted output. The index header and each entry are checked against the output, then keys
+ * of the input, between and beyond them are looked up by the index and a scan of the output from
+ * the entry found, as a reader of the index would. Index built of blocks split anywhere, so that
+ * elements span blocks, must be the same as index built at once.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <experimental/filesystem>
+
+#include <unistd.h>
+
+#include "BlobSort.h"
+#include "SparseIndex.h"
+
+using namespace ring;
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+
+constexpr auto SEED = 20261014;
+constexpr size_t ELEMENT_COUNT = 1 << 18;
+constexpr uintmax_t SMALL_MEMORY_BUDGET = 1 << 20; ///< Input of a few MB is sorted by merged runs within it
+constexpr unsigned LOOKUP_COUNT = 2000;
+
+unsigned g_failures = 0;
+
+void Check(bool passed, const std::string& message, const SortOptions& options)
+{
+	if (!passed)
+	{
+		std::cerr << "FAILED: " << message << ", interval " << options.indexInterval << ", record size "
+			<< options.recordSize << ", memory budget " << options.memoryBudget
+			<< (options.compressRuns ? ", compressed runs" : "")
+			<< (options.duplicates == DuplicateMode::Count ? ", counted output" : "") << '\n';
+		g_failures++;
+	}
+}
+
+std::vector<char> ReadFile(const fs::path& path)
+{
+	std::ifstream strm(path.string(), std::ios::binary);
+
+	return std::vector<char>(std::istreambuf_iterator<char>(strm), std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const fs::path& path, const std::vector<char>& data)
+{
+	std::ofstream strm(path.string(), std::ios::binary | std::ios::trunc);
+	strm.write(data.data(), data.size());
+}
+
+uint32_t KeyAt(const std::vector<char>& data, uint64_t offset)
+{
+	uint32_t key;
+	memcpy(&key, data.data() + offset, sizeof(key));
+
+	return key;
+}
+
+/**
+ * @brief Offset of the first element of the output of key not less than the given one, by the index
+ */
+uint64_t Lookup(const std::vector<SparseIndexEntry<uint32_t>>& entries, const std::vector<char>& output,
+	size_t elementSize, size_t keyOffset, uint32_t key)
+{
+	// Elements of the key may start before the first entry of it, right after the last entry of a less key
+	auto entry = std::lower_bound(entries.cbegin(), entries.cend(), key,
+		[](const SparseIndexEntry<uint32_t>& entry, uint32_t key) { return entry.key < key; });
+	auto offset = (entry == entries.cbegin()) ? 0 : std::prev(entry)->offset;
+
+	while (offset < output.size() && KeyAt(output, offset + keyOffset) < key)
+	{
+		offset += elementSize;
+	}
+
+	return offset;
+}
+
+/**
+ * @brief Sort input file with index, check the index against the output and look up keys by it
+ */
+void TestIndex(const fs::path& dir, const std::vector<char>& input, SortOptions options, std::mt19937_64& random)
+{
+	auto inPath = dir / "in";
+	auto outPath = dir / "out";
+	WriteFile(inPath, input);
+	SortBlobT<uint32_t>(inPath.string(), outPath.string(), options);
+
+	auto output = ReadFile(outPath);
+	auto index = ReadFile(outPath.string() + SPARSE_INDEX_FILE_SUFFIX);
+
+	size_t elementSize = options.recordSize ? options.recordSize : sizeof(uint32_t);
+	if (options.duplicates == DuplicateMode::Count)
+	{
+		elementSize += sizeof(uint64_t);
+	}
+
+	Check(index.size() >= sizeof(SparseIndexHeader<uint32_t>), "index size", options);
+	if (index.size() < sizeof(SparseIndexHeader<uint32_t>))
+	{
+		return;
+	}
+
+	SparseIndexHeader<uint32_t> header;
+	memcpy(&header, index.data(), sizeof(header));
+	std::vector<SparseIndexEntry<uint32_t>> entries((index.size() - sizeof(header)) / sizeof(entries[0]));
+	memcpy(entries.data(), index.data() + sizeof(header), entries.size() * sizeof(entries[0]));
+
+	uint64_t count = output.size() / elementSize;
+	Check(!memcmp(header.signature, SPARSE_INDEX_SIGNATURE, sizeof(header.signature)), "index signature", options);
+	Check(header.keySize == sizeof(uint32_t) && header.elementSize == elementSize &&
+		header.keyOffset == options.keyOffset && header.interval == options.indexInterval, "index header", options);
+	Check(header.count == count, "index element count", options);
+	Check(index.size() == sizeof(header) + entries.size() * sizeof(entries[0]), "index entries size", options);
+	Check(entries.size() == (count + options.indexInterval - 1) / options.indexInterval, "index entry count",
+		options);
+
+	if (count)
+	{
+		Check(header.min == KeyAt(output, options.keyOffset), "index min key", options);
+		Check(header.max == KeyAt(output, output.size() - elementSize + options.keyOffset), "index max key", options);
+	}
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		auto offset = i * options.indexInterval * elementSize;
+		Check(entries[i].offset == offset && offset < output.size() &&
+			entries[i].key == KeyAt(output, offset + options.keyOffset), "index entry", options);
+	}
+
+	std::vector<uint32_t> keys;
+	for (uint64_t i = 0; i < count; i++)
+	{
+		keys.push_back(KeyAt(output, i * elementSize + options.keyOffset));
+	}
+
+	for (unsigned i = 0; i < LOOKUP_COUNT && count; i++)
+	{
+		// Keys of the output, next to them and beyond them
+		auto key = keys[random() % count] + static_cast<uint32_t>(random() % 3) - 1;
+		auto expected = (std::lower_bound(keys.cbegin(), keys.cend(), key) - keys.cbegin()) * elementSize;
+
+		Check(Lookup(entries, output, elementSize, options.keyOffset, key) == expected, "key lookup", options);
+	}
+
+	constexpr auto MAX_KEY = std::numeric_limits<uint32_t>::max();
+	auto beyond = Lookup(entries, output, elementSize, options.keyOffset, MAX_KEY);
+	Check(beyond == output.size() || KeyAt(output, beyond + options.keyOffset) == MAX_KEY, "lookup of the max key",
+		options);
+}
+
+/**
+ * @brief Index built of blocks of random sizes must be the same as index built at once
+ */
+void TestBlocks(std::mt19937_64& random)
+{
+	constexpr size_t ELEMENT_SIZE = 12;
+	constexpr size_t KEY_OFFSET = 5;
+
+	std::vector<char> data(ELEMENT_SIZE * 1000);
+	std::generate(data.begin(), data.end(), [&]() { return static_cast<char>(random()); });
+
+	for (uint64_t interval : { 1, 3, 64, 1000, 5000 })
+	{
+		SparseIndexBuilder<uint32_t> whole(ELEMENT_SIZE, KEY_OFFSET, interval);
+		whole.Add(data.data(), data.size());
+
+		SparseIndexBuilder<uint32_t> blocks(ELEMENT_SIZE, KEY_OFFSET, interval);
+		for (size_t offset = 0; offset < data.size();)
+		{
+			auto size = std::min<size_t>(random() % (ELEMENT_SIZE * 3), data.size() - offset);
+			blocks.Add(data.data() + offset, size);
+			offset += size;
+		}
+
+		SortOptions options;
+		options.indexInterval = interval;
+		options.recordSize = ELEMENT_SIZE;
+		Check(blocks.Contents() == whole.Contents(), "index of blocks", options);
+		Check(blocks.Size() == data.size(), "indexed size of blocks", options);
+	}
+}
+
+std::vector<char> Values(std::mt19937_64& random, size_t count, uint32_t range)
+{
+	std::vector<uint32_t> values(count);
+	for (auto& value : values)
+	{
+		value = static_cast<uint32_t>(random() % range);
+	}
+
+	std::vector<char> data(values.size() * sizeof(uint32_t));
+	memcpy(data.data(), values.data(), data.size());
+
+	return data;
+}
+
+void TestSorts(const fs::path& dir, std::mt19937_64& random)
+{
+	auto values = Values(random, ELEMENT_COUNT, std::numeric_limits<uint32_t>::max());
+	auto repeated = Values(random, ELEMENT_COUNT, 1000);
+
+	for (auto interval : { uint64_t(1), uint64_t(100), uint64_t(4096), uint64_t(ELEMENT_COUNT * 2) })
+	{
+		SortOptions options;
+		options.indexInterval = interval;
+		TestIndex(dir, values, options, random);
+		TestIndex(dir, repeated, options, random);
+
+		options.memoryBudget = SMALL_MEMORY_BUDGET;
+		TestIndex(dir, values, options, random);
+		TestIndex(dir, repeated, options, random);
+
+		options.compressRuns = true;
+		TestIndex(dir, values, options, random);
+	}
+
+	SortOptions options;
+	options.indexInterval = 100;
+	TestIndex(dir, std::vector<char>(), options, random);
+	TestIndex(dir, Values(random, 1, 10), options, random);
+
+	options.duplicates = DuplicateMode::Count;
+	TestIndex(dir, repeated, options, random);
+	options.memoryBudget = SMALL_MEMORY_BUDGET;
+	TestIndex(dir, repeated, options, random);
+
+	// Records of 16 bytes keyed by the second 4 bytes
+	options = SortOptions();
+	options.indexInterval = 100;
+	options.recordSize = 16;
+	options.keyOffset = 4;
+	auto records = Values(random, ELEMENT_COUNT * 4, 100000);
+	TestIndex(dir, records, options, random);
+	options.memoryBudget = SMALL_MEMORY_BUDGET;
+	TestIndex(dir, records, options, random);
+}
+
+}
+
+int main()
+{
+	std::mt19937_64 random(SEED);
+	auto dir = fs::temp_directory_path() / ("sparse_index_test_" + std::to_string(getpid()));
+
+	try
+	{
+		fs::create_directories(dir);
+		TestBlocks(random);
+		TestSorts(dir, random);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "FAILED: " << e.what() << '\n';
+		g_failures++;
+	}
+
+	std::error_code ec;
+	fs::remove_all(dir, ec);
+
+	if (g_failures)
+	{
+		std::cerr << g_failures << " checks failed\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
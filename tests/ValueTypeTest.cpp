@@ -0,0 +1,183 @@
+/*
+ * @file: ValueTypeTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *      Author: Viacheslav Iesmanskyi <rino4work@gmail.com>
+ */
+
+/*
+ * Order tests of sorts of signed and floating point values
+ *
+ * Values around the sign flip, the type limits, signed zeros, infinities and NaNs of both signs
+ * are mixed with random ones and sorted in memory and through merged runs by either kernel.
+ * Sorted values are compared bit by bit to the IEEE total order, since NaNs don't compare equal.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <cstring>
+#include <cstdlib>
+
+#include "BlobSort.h"
+
+using namespace ring;
+
+namespace
+{
+
+constexpr auto SEED = 20261014;
+constexpr size_t VALUE_COUNT = 1 << 20;
+constexpr uintmax_t SMALL_MEMORY_BUDGET = 1 << 20; ///< Input of a few MB is sorted by merged runs within it
+
+unsigned g_failures = 0;
+
+template <typename T>
+void Check(bool passed, const std::string& message, const SortOptions& options)
+{
+	if (!passed)
+	{
+		std::cerr << "FAILED: " << message << ", " << sizeof(T) * 8 << "-bit "
+			<< (std::is_floating_point<T>::value ? "floating point" : "signed") << " values, memory budget "
+			<< options.memoryBudget << ", " << (options.sortKernel == SortKernel::Radix ? "radix" : "std") << " kernel\n";
+		g_failures++;
+	}
+}
+
+/**
+ * @brief Unsigned bits of value
+ */
+template <typename T>
+auto Bits(T value)
+{
+	std::make_unsigned_t<std::conditional_t<std::is_floating_point<T>::value,
+		std::conditional_t<sizeof(T) == 4, int32_t, int64_t>, T>> bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	return bits;
+}
+
+/**
+ * @brief Unsigned key ordered as the value - the sign bit flipped, and the other bits too if negative floating point
+ */
+template <typename T>
+auto OrderKey(T value)
+{
+	auto bits = Bits(value);
+	decltype(bits) sign = decltype(bits)(1) << (sizeof(T) * 8 - 1);
+
+	if (std::is_floating_point<T>::value && (bits & sign))
+	{
+		return static_cast<decltype(bits)>(~bits);
+	}
+
+	return static_cast<decltype(bits)>(bits ^ sign);
+}
+
+template <typename T>
+std::vector<T> SpecialValues(std::true_type /* floating point */)
+{
+	using Limits = std::numeric_limits<T>;
+
+	return { T(0), -T(0), T(1), T(-1), Limits::min(), -Limits::min(), Limits::denorm_min(), -Limits::denorm_min(),
+		Limits::max(), Limits::lowest(), Limits::infinity(), -Limits::infinity(), Limits::quiet_NaN(),
+		-Limits::quiet_NaN(), Limits::signaling_NaN(), -Limits::signaling_NaN() };
+}
+
+template <typename T>
+std::vector<T> SpecialValues(std::false_type /* signed integer */)
+{
+	using Limits = std::numeric_limits<T>;
+
+	return { T(0), T(1), T(-1), Limits::max(), Limits::min(), T(Limits::max() - 1), T(Limits::min() + 1) };
+}
+
+/**
+ * @brief Special values and random ones of the whole range, negative ones included
+ */
+template <typename T>
+std::vector<T> Values(std::mt19937_64& random)
+{
+	auto special = SpecialValues<T>(std::is_floating_point<T>());
+	std::vector<T> values;
+
+	while (values.size() < VALUE_COUNT)
+	{
+		if (random() % 16 == 0)
+		{
+			values.push_back(special[random() % special.size()]);
+		}
+		else
+		{
+			auto bits = static_cast<decltype(Bits(T()))>(random());
+			T value;
+			memcpy(&value, &bits, sizeof(value));
+			values.push_back(value);
+		}
+	}
+
+	return values;
+}
+
+template <typename T>
+void TestOrder(const std::vector<T>& values, const SortOptions& options)
+{
+	std::vector<T> expected(values);
+	std::sort(expected.begin(), expected.end(), [](T left, T right) { return OrderKey(left) < OrderKey(right); });
+
+	std::vector<T> sorted;
+	SortBlobT<T>(values.data(), values.size(), [&](const T* data, size_t count)
+	{	sorted.insert(sorted.end(), data, data + count);}, options);
+
+	Check<T>(sorted.size() == expected.size(), "sorted value count", options);
+	Check<T>(sorted.size() == expected.size() && !memcmp(sorted.data(), expected.data(), sorted.size() * sizeof(T)),
+		"sorted values", options);
+}
+
+template <typename T>
+void TestType(std::mt19937_64& random)
+{
+	auto values = Values<T>(random);
+
+	for (auto kernel : { SortKernel::Radix, SortKernel::Std })
+	{
+		SortOptions options;
+		options.sortKernel = kernel;
+		TestOrder(values, options);
+
+		options.memoryBudget = SMALL_MEMORY_BUDGET;
+		TestOrder(values, options);
+	}
+}
+
+}
+
+int main()
+{
+	std::mt19937_64 random(SEED);
+
+	try
+	{
+		TestType<int16_t>(random);
+		TestType<int32_t>(random);
+		TestType<int64_t>(random);
+		TestType<float>(random);
+		TestType<double>(random);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "FAILED: " << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	if (g_failures)
+	{
+		std::cerr << g_failures << " checks failed\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}